@@ -28,36 +28,38 @@
 #include <algorithm>
 #include <iostream>
 #include <base.hpp>
-
-std::string new_tmp()
-{
-  static int n = 0;
-  std::stringstream ss;
-  ss << "unnamed" << n++;
-  return ss.str();
-}
+#include <context.hpp>
 
 hdl::detail::named_obj::named_obj(std::string name)
-  : myname(name == "" ? new_tmp() : name)
 {
+  if(name == "")
+    tmp = hdl::context::current().new_tmp();
+  else
+    myname.reset(new std::string(name));
 }
 
 std::string hdl::detail::named_obj::getname() const
 {
-  return myname;
+  if(myname)
+    return *myname;
+  std::stringstream ss;
+  ss << "unnamed" << tmp;
+  return ss.str();
 }
 
 void hdl::detail::named_obj::setname(std::string name)
 {
-  myname = name;
+  myname.reset(new std::string(name));
+}
+
+bool hdl::detail::named_obj::named() const
+{
+  return myname != nullptr;
 }
 
 void hdl::cleanup()
 {
-  hdl::detail::wires.clear();
-  hdl::detail::parts.clear();
+  hdl::context::current().clear();
 }
 
-std::vector<std::shared_ptr<hdl::detail::base> > hdl::detail::wires;
-std::vector<std::shared_ptr<hdl::detail::base> > hdl::detail::parts;
 thread_local hdl::detail::base* hdl::detail::base::cur_part;
@@ -28,6 +28,7 @@
 #ifndef BASE_HPP
 #define BASE_HPP
 
+#include <atomic>
 #include <list>
 #include <memory>
 #include <string>
@@ -36,7 +37,6 @@
 #include <algorithm>
 #include <sstream>
 #include <unordered_map>
-#include <unordered_set>
 
 namespace hdl
 {
@@ -48,6 +48,10 @@ namespace hdl
 
   class simulator;
   class part;
+  class context;
+  class compiled;
+  class codegen;
+  class optimizer;
 
   void cleanup();
 
@@ -65,40 +69,94 @@ namespace hdl
     {
     };
 
+    class archive;
+    class graph;
+    class kind_base;
+    class fused_part;
+
+    // Only names chosen by the user are stored, the others are numbered.
     class named_obj
     {
     private:
-      std::string myname;
+      std::unique_ptr<std::string> myname;
+      unsigned int tmp = 0;
 
     public:
       named_obj(std::string name = "");
       std::string getname() const;
       virtual void setname(std::string name);
+
+      // whether the name was chosen by the user
+      bool named() const;
     };
 
     class base : public named_obj
     {
     private:
       static thread_local base* cur_part;
-      bool been_changed = false;
+      std::atomic<bool> been_changed{false};
+      bool been_queued = false;
 
     protected:
-      std::unordered_set<std::shared_ptr<base> > children;
+      // index in the wires or parts of the context
+      unsigned int id = 0;
 
       inline void set_cur_part(base *the_part) { cur_part = the_part; }
       inline base *get_cur_part() { return cur_part; }
 
-      inline void set_changed(bool b) { been_changed = b; }
-      inline bool changed() { return been_changed; }
+      // may be set concurrently by parts evaluated in parallel
+      inline void set_changed(bool b) { been_changed.store(b, std::memory_order_relaxed); }
+      inline bool changed() { return been_changed.load(std::memory_order_relaxed); }
+
+      inline void set_queued(bool b) { been_queued = b; }
+      inline bool queued() { return been_queued; }
 
       virtual void update(uint64_t time) = 0;
 
+      // edge of the last update
+      virtual bool rose() { return false; }
+      virtual bool fell() { return false; }
+
+      // whether the last update changed the value
+      virtual bool value_changed() const { return false; }
+
+      // whether the value differs from the one before the last update
+      virtual bool differs() const { return false; }
+
+      // index of the value in the store of its type
+      virtual unsigned int value_slot() const { return 0; }
+
+      // whether the value is resolved from several drivers
+      virtual bool resolved() const { return false; }
+
+      // called for every wire when the context is frozen
+      virtual void freeze(const graph &) { }
+
+      // called for every wire before the context is frozen again
+      virtual void thaw() { }
+
+      // Share the value of a wire of the same type instead of being
+      // updated, returns false if the types differ.
+      virtual bool alias(base *) { return false; }
+
+      // keep the current value without a driver
+      virtual void hold() { }
+
+      // simulation state for snapshots
+      virtual void save(archive &) { }
+      virtual void load(archive &) { }
+
       friend class hdl::simulator;
+      friend class hdl::compiled;
+      friend class hdl::codegen;
+      friend class hdl::optimizer;
       friend class hdl::part;
+      friend class hdl::context;
+      friend class archive;
+      friend class graph;
+      friend class kind_base;
+      friend class fused_part;
     };
-    
-    extern std::vector<std::shared_ptr<base> > wires;
-    extern std::vector<std::shared_ptr<base> > parts;
   }
 }
 
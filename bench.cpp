@@ -0,0 +1,399 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define SYMMETRIC
+#include <hdlsim.hpp>
+
+using namespace hdl;
+
+// Reproducible workloads for tracking the performance of the
+// scheduler and of fixed_t. Every workload is built in its own
+// context and run in its own process, and prints one line of JSON.
+//
+//   bench [options] [workload ...]
+//
+//   --ticks n     time steps to simulate (default 10000)
+//   --size n      size of the workloads instead of their defaults
+//   --fanout n    readers per wire in the random DAG (default 4)
+//   --seed n      seed of the random DAG (default 1)
+//   --levelize    use the levelized scheduler
+//   --optimize    run the optimizer before simulating
+//   --threads n   evaluate parts on n threads
+//   --min-parts n parts per thread for a delta cycle to go parallel
+//                 (default 256)
+//   --grain n     least parts per pool task (default 64)
+//
+// Events are updates of wires, evaluations include the testbench and
+// the peak RSS is the one of the whole process. Wires and parts are
+// counted as built, simulated_wires and simulated_parts after the
+// optimizer.
+
+namespace
+{
+  struct options
+  {
+    uint64_t ticks = 10000;
+    unsigned int size = 0;
+    unsigned int fanout = 4;
+    unsigned int seed = 1;
+    bool levelize = false;
+    bool optimize = false;
+    unsigned int threads = 1;
+    unsigned int min_parts = 256;
+    unsigned int grain = 64;
+  };
+
+  typedef wire<std_logic> logic;
+  typedef std::list<std::shared_ptr<detail::base> > wires_t;
+
+  // Results of a workload are named, so that the optimizer keeps the
+  // parts they depend on.
+  template <typename T>
+  void result(wire<T> w, unsigned int c)
+  {
+    w.setname("result" + std::to_string(c));
+  }
+
+  // clock and active low reset
+  part clock(logic clk, logic reset)
+  {
+    return part({ }, { clk, reset }, [=] (uint64_t t)
+                {
+                  clk = t % 2;
+                  reset = t >= 4;
+                }, "tb");
+  }
+
+  // size bit ripple carry adder of single gates, new random operands
+  // every time step
+  part ripple(unsigned int n, const options &o)
+  {
+    std::vector<logic> a(n), b(n), s(n), carry(n+1);
+    carry[0] = 0;
+    for(unsigned int c = 0; c < n; c++)
+      {
+        logic x, g, p;
+        bxor(a[c], b[c], x);
+        bxor(x, carry[c], s[c]);
+        band(a[c], b[c], g);
+        band(x, carry[c], p);
+        bor(g, p, carry[c+1]);
+        result(s[c], c);
+      }
+    result(carry[n], n);
+
+    wires_t operands;
+    for(unsigned int c = 0; c < n; c++)
+      {
+        operands.push_back(a[c]);
+        operands.push_back(b[c]);
+      }
+    std::shared_ptr<std::mt19937> rng(new std::mt19937(o.seed));
+    return part({ }, { operands }, [=] (uint64_t)
+                {
+                  for(unsigned int c = 0; c < n; c++)
+                    {
+                      unsigned int r = (*rng)();
+                      a[c] = static_cast<bool>(r & 1);
+                      b[c] = static_cast<bool>(r & 2);
+                    }
+                }, "tb");
+  }
+
+  // size chains of 64 registers, fed by a counter
+  part delays(unsigned int n, const options &)
+  {
+    logic clk, reset, one(1);
+    std::vector<wire<fixed_t<false, 16, 0> > > stages(n+1);
+    counter(clk, reset, one, stages[0]);
+    for(unsigned int c = 0; c < n; c++)
+      delay<64>(clk, reset, one, stages[c], stages[c+1]);
+    result(stages[n], 0);
+    return clock(clk, reset);
+  }
+
+  // size pairs of a decimating and an interpolating CIC filter
+  part cic(unsigned int n, const options &)
+  {
+    logic clk, clk2, reset, one(1);
+    clkdiv<16>(clk, reset, one, clk2);
+    for(unsigned int c = 0; c < n; c++)
+      {
+        wire<fixed_t<true, 2, 14> > sine, cosine, down, up;
+        nco(clk, reset, one,
+            wire<fixed_t<false, 0, 16> >(0.001 * (c + 1)),
+            wire<fixed_t<false, 0, 16> >(0.),
+            sine, cosine, wire<fixed_t<false, 0, 16> >());
+        cic_down<3, 4>(clk, clk2, reset, one, sine, down);
+        cic_up<3, 4>(clk2, clk, reset, one, down, up);
+        result(up, c);
+      }
+    return clock(clk, reset);
+  }
+
+  // size phase locked loops locking onto an NCO
+  part plls(unsigned int n, const options &)
+  {
+    logic clk, reset, one(1);
+    for(unsigned int c = 0; c < n; c++)
+      {
+        wire<fixed_t<true, 4, 8> > sine, cosine;
+        wire<fixed_t<false, 0, 16> > fout;
+        wire<fixed_t<true, 8, 16> > i, q;
+        nco(clk, reset, one,
+            wire<fixed_t<false, 0, 16> >(0.1 + 0.0001 * c),
+            wire<fixed_t<false, 0, 16> >(0.),
+            sine, cosine, wire<fixed_t<false, 0, 16> >());
+        pll<8, 16>(clk, reset, one, sine,
+                   wire<fixed_t<false, 0, 16> >(0.1),
+                   wire<fixed_t<true, 6, 0> >(-3),
+                   wire<fixed_t<true, 6, 0> >(-6),
+                   fout, i, q, q);
+        result(fout, c);
+      }
+    return clock(clk, reset);
+  }
+
+  // counter() builds its increment from an unsigned int, which does
+  // not reach 32 bits and more
+  template <unsigned int bits>
+  void wide_counter(logic clk, logic reset, logic enable, wire<fixed_t<false, bits, 0> > out)
+  {
+    integrator(clk, reset, enable, wire<fixed_t<false, bits, 0> >(1.), out);
+  }
+
+  // size wide counters
+  part counters(unsigned int n, const options &)
+  {
+    logic clk, reset, one(1);
+    for(unsigned int c = 0; c < n; c++)
+      {
+        wire<fixed_t<false, 128, 0> > count;
+        wide_counter(clk, reset, one, count);
+        result(count, c);
+      }
+    return clock(clk, reset);
+  }
+
+  // size adders and subtractors connected at random, every wire is
+  // read by at most fanout parts
+  part dag(unsigned int n, const options &o)
+  {
+    logic clk, reset, one(1);
+    std::mt19937 rng(o.seed);
+    // assigning wires copies values, so they are only referred to by
+    // index here
+    std::vector<wire<fixed_t<false, 32, 0> > > wires;
+    std::vector<unsigned int> readers;
+    std::vector<unsigned int> open;
+
+    auto pick = [&] ()
+      {
+        if(open.size() < 2)
+          {
+            wires.push_back(wire<fixed_t<false, 32, 0> >());
+            readers.push_back(0);
+            wide_counter(clk, reset, one, wires.back());
+            open.push_back(wires.size()-1);
+          }
+        unsigned int c = rng() % open.size();
+        unsigned int w = open[c];
+        if(++readers[w] >= o.fanout)
+          {
+            open[c] = open.back();
+            open.pop_back();
+          }
+        return w;
+      };
+
+    for(unsigned int c = 0; c < n; c++)
+      {
+        unsigned int in1 = pick();
+        unsigned int in2 = pick();
+        wires.push_back(wire<fixed_t<false, 32, 0> >());
+        readers.push_back(0);
+        if(rng() % 2)
+          add(wires[in1], wires[in2], wires.back());
+        else
+          sub(wires[in1], wires[in2], wires.back());
+        open.push_back(wires.size()-1);
+      }
+    for(unsigned int w = 0; w < wires.size(); w++)
+      if(readers[w] == 0)
+        result(wires[w], w);
+    return clock(clk, reset);
+  }
+
+  struct workload
+  {
+    part (*build)(unsigned int size, const options &o);
+    unsigned int size;
+  };
+
+  const std::map<std::string, workload> workloads =
+    {
+      { "ripple", { ripple, 256 } },
+      { "delay", { delays, 100 } },
+      { "cic", { cic, 100 } },
+      { "pll", { plls, 100 } },
+      { "counter", { counters, 1000 } },
+      { "dag", { dag, 1000 } },
+    };
+
+  double seconds_since(std::chrono::steady_clock::time_point t)
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+  }
+
+  void run(const std::string &name, const options &o)
+  {
+    context ctx;
+    context::scope bind(ctx);
+
+    auto t0 = std::chrono::steady_clock::now();
+    const workload &w = workloads.at(name);
+    unsigned int size = o.size ? o.size : w.size;
+    part tb = w.build(size, o);
+    unsigned int wires = ctx.num_wires();
+    unsigned int parts = ctx.num_parts();
+    if(o.optimize)
+      optimizer().run();
+    ctx.freeze();
+    double elaboration = seconds_since(t0);
+
+    simulator sim(tb);
+    sim.levelize(o.levelize);
+    sim.threads(o.threads, o.min_parts, o.grain);
+    t0 = std::chrono::steady_clock::now();
+    sim.run(o.ticks);
+    double seconds = seconds_since(t0);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    const simulator::statistics &s = sim.stats();
+    std::cout << "{\"workload\": \"" << name << "\""
+              << ", \"size\": " << size
+              << ", \"ticks\": " << o.ticks
+              << ", \"levelized\": " << (o.levelize ? "true" : "false")
+              << ", \"optimized\": " << (o.optimize ? "true" : "false")
+              << ", \"threads\": " << o.threads
+              << ", \"min_parts\": " << o.min_parts
+              << ", \"grain\": " << o.grain
+              << ", \"wires\": " << wires
+              << ", \"parts\": " << parts
+              << ", \"simulated_wires\": " << ctx.num_wires()
+              << ", \"simulated_parts\": " << ctx.num_parts()
+              << ", \"elaboration_s\": " << elaboration
+              << ", \"run_s\": " << seconds
+              << ", \"events_per_s\": " << s.updates / seconds
+              << ", \"evaluations_per_s\": " << s.evaluations / seconds
+              << ", \"deltas_per_tick\": " << static_cast<double>(s.deltas) / s.steps
+              << ", \"peak_rss_kb\": " << usage.ru_maxrss
+              << "}" << std::endl;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  options o;
+  std::vector<std::string> names;
+  for(int c = 1; c < argc; c++)
+    {
+      std::string arg = argv[c];
+      bool more = c+1 < argc;
+      if(arg == "--ticks" && more)
+        o.ticks = std::strtoull(argv[++c], NULL, 10);
+      else if(arg == "--size" && more)
+        o.size = std::atoi(argv[++c]);
+      else if(arg == "--fanout" && more)
+        o.fanout = std::max(1, std::atoi(argv[++c]));
+      else if(arg == "--seed" && more)
+        o.seed = std::atoi(argv[++c]);
+      else if(arg == "--levelize")
+        o.levelize = true;
+      else if(arg == "--optimize")
+        o.optimize = true;
+      else if(arg == "--threads" && more)
+        o.threads = std::atoi(argv[++c]);
+      else if(arg == "--min-parts" && more)
+        o.min_parts = std::atoi(argv[++c]);
+      else if(arg == "--grain" && more)
+        o.grain = std::atoi(argv[++c]);
+      else if(workloads.count(arg))
+        names.push_back(arg);
+      else
+        {
+          std::cerr << "Usage: " << argv[0] << " [--ticks n] [--size n] [--fanout n] [--seed n]"
+                    << " [--levelize] [--optimize] [--threads n] [--min-parts n] [--grain n]"
+                    << " [workload ...]" << std::endl
+                    << "Workloads:";
+          for(auto &w : workloads)
+            std::cerr << " " << w.first;
+          std::cerr << std::endl;
+          return 1;
+        }
+    }
+  if(names.size() == 0)
+    for(auto &w : workloads)
+      names.push_back(w.first);
+
+  // one process per workload, so the peak RSS is its own
+  int result = 0;
+  for(auto &name : names)
+    {
+      std::cout.flush();
+      pid_t pid = fork();
+      if(pid == 0)
+        {
+          run(name, o);
+          std::cout.flush();
+          _exit(0);
+        }
+      int status = 0;
+      if(pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+          std::cerr << "ERROR: Workload " << name << " failed." << std::endl;
+          result = 1;
+        }
+    }
+  return result;
+}
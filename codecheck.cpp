@@ -0,0 +1,177 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <hdlsim.hpp>
+
+using namespace hdl;
+
+// Checks the code written by codegen against the event loop. Built
+// twice: with GENERATE it writes the code for the design below into
+// the file given as argument, without it runs the design with that
+// code (see compiled) and with the simulator in both schedulers and
+// compares all wires after every time step.
+// Exits with 1 if the compiled run deviates.
+
+namespace
+{
+  const uint64_t ticks = 300;
+
+  typedef fixed_t<false, 8, 0> byte;
+
+  // The testbench only depends on the time.
+  struct design
+  {
+    std::vector<wire<std_logic> > bits;
+    std::vector<wire<byte> > numbers;
+
+    part build()
+    {
+      wire<std_logic> clk, reset, one(1), a, b, x, y, nx, q, parity;
+      wire<byte> count, delayed, sum, diff, held;
+      wire<bool> equal, smaller, greater;
+      counter(clk, reset, one, count);
+      delay<3>(clk, reset, one, count, delayed);
+      add(count, delayed, sum);
+      sub(count, delayed, diff);
+      compare(sum, diff, equal, smaller, greater);
+      reg(clk, reset, one, sum, held);
+      bxor(a, b, x);
+      band(x, a, y);
+      invert(x, nx);
+      reg(clk, reset, one, y, q);
+
+      // called through the part table
+      part({ x, q, nx }, { parity }, [=] (uint64_t)
+           {
+             parity = std_logic(x) == std_logic(q) ? std_logic(nx) : std_logic(true);
+           }, "parity");
+
+      bits = { clk, reset, a, b, x, y, nx, q, parity };
+      numbers = { count, delayed, sum, diff, held };
+      flags = { equal, smaller, greater };
+      return part({}, { { clk, reset, a, b } }, [=] (uint64_t t)
+                  {
+                    clk = t % 2;
+                    reset = t >= 4;
+                    a = (t * 7 + t / 3) % 5 < 2;
+                    b = t % 11 < 6;
+                  }, "tb");
+    }
+
+    std::vector<wire<bool> > flags;
+
+    std::string values() const
+    {
+      std::stringstream ss;
+      for(auto &w : bits)
+        ss << std_logic(w);
+      for(auto &w : flags)
+        ss << w.get();
+      for(auto &w : numbers)
+        ss << " " << static_cast<double>(w.get());
+      return ss.str();
+    }
+  };
+}
+
+#ifdef GENERATE
+
+int main(int argc, char **argv)
+{
+  if(argc < 2)
+    {
+      std::cerr << "Usage: " << argv[0] << " <output.cpp>" << std::endl;
+      return 1;
+    }
+  design d;
+  part tb = d.build();
+  std::ofstream out(argv[1]);
+  codegen(tb).write(out, "codecheck_design");
+  return out ? 0 : 1;
+}
+
+#else
+
+extern const compiled::design codecheck_design;
+
+namespace
+{
+  std::vector<std::string> simulate(bool levelized)
+  {
+    context ctx;
+    context::scope bind(ctx);
+    design d;
+    simulator sim(d.build());
+    sim.levelize(levelized);
+    std::vector<std::string> trace;
+    for(uint64_t t = 0; t < ticks; t++)
+      {
+        sim.run(1);
+        trace.push_back(d.values());
+      }
+    return trace;
+  }
+}
+
+int main()
+{
+  std::vector<std::string> code;
+  {
+    context ctx;
+    context::scope bind(ctx);
+    design d;
+    compiled c(d.build(), codecheck_design);
+    for(uint64_t t = 0; t < ticks; t++)
+      {
+        c.run(1);
+        code.push_back(d.values());
+      }
+  }
+
+  unsigned int failures = 0;
+  for(bool levelized : { false, true })
+    {
+      std::vector<std::string> sim = simulate(levelized);
+      for(uint64_t t = 0; t < ticks; t++)
+        if(code[t] != sim[t])
+          {
+            std::cout << (levelized ? "levelized" : "event") << " [" << t << "]: "
+                      << sim[t] << ", compiled " << code[t] << std::endl;
+            failures++;
+          }
+    }
+  std::cout << failures << " deviations" << std::endl;
+  return failures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,384 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <sstream>
+#include <codegen.hpp>
+#include <context.hpp>
+#include <kind.hpp>
+
+using namespace hdl;
+
+namespace
+{
+  // parts per generated function, compilers choke on huge functions
+  const unsigned int chunk = 256;
+
+  // a wire passed to a kernel
+  struct ref
+  {
+    unsigned int id;
+    unsigned int slot;
+    std::string type;
+  };
+
+  // code of one part and the stores it uses
+  struct block
+  {
+    std::string code;
+    std::set<unsigned int> stores;
+  };
+
+  struct unit
+  {
+    const detail::graph &g;
+    std::vector<std::unique_ptr<detail::kernel_info> > kernel;
+    std::vector<std::vector<ref> > ports;
+    std::vector<unsigned char> feedback;
+    std::map<std::string, unsigned int> stores;
+    std::set<unsigned int> used;
+
+    // sensitivity per part
+    std::vector<std::vector<unsigned int> > level, posedge, negedge;
+
+    unit(const detail::graph &g)
+      : g(g), kernel(g.parts.size()),
+        ports(g.parts.size()),
+        feedback(g.wires.size(), 0),
+        level(g.parts.size()), posedge(g.parts.size()), negedge(g.parts.size())
+    {
+    }
+
+    std::string store(const std::string &type)
+    {
+      auto s = stores.find(type);
+      unsigned int n = stores.size();
+      if(s == stores.end())
+        stores[type] = n;
+      else
+        n = s->second;
+      used.insert(n);
+      return "s" + std::to_string(n);
+    }
+
+    std::string value(const ref &w)
+    {
+      std::string v = store(w.type) + ".state[" + std::to_string(w.slot) + "]";
+      return w.type == "bool" ? "static_cast<bool>(" + v + ")" : v;
+    }
+
+    std::string trigger(unsigned int p) const
+    {
+      std::string se = "se[" + std::to_string(p) + "]";
+      std::vector<std::string> terms;
+      if(level[p].size() > 0)
+        terms.push_back("c.first");
+      for(auto w : level[p])
+        terms.push_back("st[" + std::to_string(w) + "] > " + se);
+      for(auto w : posedge[p])
+        terms.push_back("(st[" + std::to_string(w) + "] > " + se + " && c.rose(" + std::to_string(w) + "))");
+      for(auto w : negedge[p])
+        terms.push_back("(st[" + std::to_string(w) + "] > " + se + " && c.fell(" + std::to_string(w) + "))");
+      std::string t;
+      for(auto &s : terms)
+        t += (t == "" ? "" : " || ") + s;
+      return t;
+    }
+
+    std::string output(unsigned int p, unsigned int n) const
+    {
+      return "o" + std::to_string(p) + "_" + std::to_string(n);
+    }
+
+    // declare the outputs of a kernel
+    void declare(std::ostream &out, unsigned int p, const std::string &indent) const
+    {
+      for(unsigned int n = kernel[p]->inputs; n < ports[p].size(); n++)
+        out << indent << ports[p][n].type << " " << output(p, n - kernel[p]->inputs) << ";" << std::endl;
+    }
+
+    std::string call(unsigned int p)
+    {
+      const detail::kernel_info &k = *kernel[p];
+      std::string args;
+      auto arg = [&args] (const std::string &a)
+        {
+          args += (args == "" ? "" : ", ") + a;
+        };
+      if(k.event)
+        arg("e");
+      for(unsigned int n = 0; n < ports[p].size(); n++)
+        arg(n < k.inputs ? value(ports[p][n]) : output(p, n - k.inputs));
+      return std::string(k.name) + "(" + k.args + ").eval(" + args + ")";
+    }
+
+    void set(std::ostream &out, unsigned int p, const std::string &indent)
+    {
+      for(unsigned int n = kernel[p]->inputs; n < ports[p].size(); n++)
+        {
+          const ref &w = ports[p][n];
+          out << indent << "c.set(" << store(w.type) << ", "
+              << w.slot << ", " << w.id << ", " << output(p, n - kernel[p]->inputs) << ", "
+              << (feedback[w.id] ? "true" : "false") << ");" << std::endl;
+        }
+    }
+
+    // Evaluate a part and set result if it has written its outputs,
+    // the outputs of a kernel are declared already.
+    void evaluate(std::ostream &out, unsigned int p, const std::string &result,
+                  const std::string &indent)
+    {
+      out << indent << "if(" << trigger(p) << ")" << std::endl
+          << indent << "  {" << std::endl;
+      if(kernel[p] && kernel[p]->event)
+        out << indent << "    bool e = st[" << ports[p][0].id << "] > se[" << p << "];" << std::endl;
+      out << indent << "    se[" << p << "] = c.now;" << std::endl;
+      if(!kernel[p])
+        out << indent << "    c.evaluate(" << p << ", time);" << std::endl
+            << indent << "    " << result << " = true;" << std::endl;
+      else if(kernel[p]->conditional)
+        out << indent << "    " << result << " = " << call(p) << ";" << std::endl;
+      else
+        out << indent << "    " << call(p) << ";" << std::endl
+            << indent << "    " << result << " = true;" << std::endl;
+      out << indent << "  }" << std::endl;
+    }
+
+    block finish(std::ostringstream &code)
+    {
+      block b = { code.str(), used };
+      used.clear();
+      return b;
+    }
+
+    // edge triggered parts keep their results until all have run
+    block evaluate_seq(unsigned int p)
+    {
+      std::ostringstream out;
+      out << "  // " << g.parts[p]->getname() << std::endl
+          << "  w" << p << " = false;" << std::endl;
+      evaluate(out, p, "w" + std::to_string(p), "  ");
+      return finish(out);
+    }
+
+    block commit_seq(unsigned int p)
+    {
+      std::ostringstream out;
+      out << "  if(w" << p << ")" << std::endl;
+      if(!kernel[p])
+        out << "    c.commit(" << p << ", time);" << std::endl;
+      else
+        {
+          out << "    {" << std::endl;
+          set(out, p, "      ");
+          out << "    }" << std::endl;
+        }
+      return finish(out);
+    }
+
+    block comb(unsigned int p)
+    {
+      std::ostringstream out;
+      out << "  // " << g.parts[p]->getname() << std::endl;
+      if(!kernel[p])
+        out << "  if(" << trigger(p) << ")" << std::endl
+            << "    {" << std::endl
+            << "      se[" << p << "] = c.now;" << std::endl
+            << "      c.evaluate(" << p << ", time);" << std::endl
+            << "      c.commit(" << p << ", time);" << std::endl
+            << "    }" << std::endl;
+      else
+        {
+          out << "  {" << std::endl;
+          declare(out, p, "    ");
+          out << "    bool w = false;" << std::endl;
+          evaluate(out, p, "w", "    ");
+          out << "    if(w)" << std::endl
+              << "      {" << std::endl;
+          set(out, p, "        ");
+          out << "      }" << std::endl
+              << "  }" << std::endl;
+        }
+      return finish(out);
+    }
+  };
+}
+
+codegen::codegen(part testbench)
+  : tb(testbench)
+{
+}
+
+void codegen::write(std::ostream &out, const std::string &name) const
+{
+  context &ctx = context::current();
+  ctx.freeze();
+  const detail::graph &g = ctx.flat;
+  unsigned int testbench = tb.p->id;
+  unit u(g);
+
+  for(unsigned int w = 0; w < g.wires.size(); w++)
+    {
+      for(auto p = g.readers.first(w); p != g.readers.last(w); p++)
+        u.level[*p].push_back(w);
+      for(auto p = g.posedge.first(w); p != g.posedge.last(w); p++)
+        u.posedge[*p].push_back(w);
+      for(auto p = g.negedge.first(w); p != g.negedge.last(w); p++)
+        u.negedge[*p].push_back(w);
+    }
+
+  // Kernels can only write wires with a single driver and need the
+  // names of all types.
+  for(unsigned int p = 0; p < g.parts.size(); p++)
+    {
+      if(!g.kinds[p])
+        continue;
+      detail::kernel_info k = g.kinds[p]->describe(g.members[p]);
+      auto in_graph = [&g] (const detail::base *w)
+        {
+          return w->id < g.wires.size() && g.wires[w->id] == w;
+        };
+      bool ok = true;
+      for(unsigned int n = 0; n < k.ports.size(); n++)
+        {
+          const detail::base *w = k.ports[n].w;
+          u.ports[p].push_back({ w->id, w->value_slot(), k.ports[n].type() });
+          ok = ok && u.ports[p].back().type != "" && in_graph(w)
+            && (n < k.inputs || !w->resolved());
+        }
+      if(ok)
+        u.kernel[p].reset(new detail::kernel_info(k));
+    }
+
+  // Edge triggered parts come first, the others in level order.
+  // Parts that are not sensitive to anything never run.
+  std::vector<unsigned int> level;
+  g.rank(level);
+  std::vector<unsigned int> seq, comb;
+  for(unsigned int p = 0; p < g.parts.size(); p++)
+    if(p == testbench)
+      continue;
+    else if(u.posedge[p].size() > 0 || u.negedge[p].size() > 0)
+      seq.push_back(p);
+    else if(u.level[p].size() > 0)
+      comb.push_back(p);
+  std::stable_sort(comb.begin(), comb.end(),
+                   [&level] (unsigned int a, unsigned int b) { return level[a] < level[b]; });
+
+  // A change needs another pass if it wakes up an edge triggered part
+  // or one that has been evaluated before in the pass.
+  const unsigned int none = g.parts.size();
+  std::vector<unsigned int> pos(g.parts.size(), none);
+  for(unsigned int n = 0; n < comb.size(); n++)
+    pos[comb[n]] = n;
+  for(unsigned int w = 0; w < g.wires.size(); w++)
+    for(auto d = g.writers.first(w); d != g.writers.last(w); d++)
+      for(const detail::csr *c : { &g.readers, &g.posedge, &g.negedge })
+        for(auto r = c->first(w); r != c->last(w); r++)
+          if(*r != testbench && (pos[*r] == none || (pos[*d] != none && pos[*r] <= pos[*d])))
+            if(u.posedge[*r].size() > 0 || u.negedge[*r].size() > 0 || u.level[*r].size() > 0)
+              u.feedback[w] = 1;
+
+  std::vector<std::vector<block> > phases(3);
+  for(auto p : seq)
+    phases[0].push_back(u.evaluate_seq(p));
+  for(auto p : seq)
+    phases[1].push_back(u.commit_seq(p));
+  for(auto p : comb)
+    phases[2].push_back(u.comb(p));
+
+  std::vector<std::string> types(u.stores.size());
+  for(auto &s : u.stores)
+    types[s.second] = s.first;
+
+  out << "// Generated by hdl::codegen, do not edit." << std::endl
+      << "// " << g.wires.size() << " wires, " << g.parts.size() << " parts." << std::endl
+      << std::endl
+      << "#include <hdlsim.hpp>" << std::endl
+      << std::endl
+      << "namespace" << std::endl
+      << "{" << std::endl
+      << "const unsigned char feedback[] =" << std::endl
+      << "  {";
+  for(unsigned int w = 0; w < g.wires.size(); w++)
+    out << (w % 32 == 0 ? "\n    " : " ") << static_cast<unsigned int>(u.feedback[w]) << ",";
+  if(g.wires.size() == 0)
+    out << "0";
+  out << std::endl << "  };" << std::endl;
+
+  if(seq.size() > 0)
+    {
+      out << std::endl
+          << "// results of the edge triggered parts" << std::endl;
+      for(auto p : seq)
+        {
+          out << "bool w" << p << ";" << std::endl;
+          if(u.kernel[p])
+            u.declare(out, p, "");
+        }
+    }
+
+  unsigned int functions = 0;
+  for(auto &phase : phases)
+    for(unsigned int first = 0; first < phase.size(); first += chunk)
+      {
+        unsigned int last = std::min<unsigned int>(first + chunk, phase.size());
+        std::set<unsigned int> stores;
+        for(unsigned int b = first; b < last; b++)
+          stores.insert(phase[b].stores.begin(), phase[b].stores.end());
+        out << std::endl
+            << "void f" << functions++ << "(hdl::compiled &c, uint64_t time)" << std::endl
+            << "{" << std::endl
+            << "  uint64_t *st = c.stamp.data();" << std::endl
+            << "  uint64_t *se = c.seen.data();" << std::endl
+            << "  (void)time;" << std::endl
+            << "  (void)st;" << std::endl
+            << "  (void)se;" << std::endl;
+        for(auto n : stores)
+          out << "  hdl::detail::value_store<" << types[n] << " > &s" << n
+              << " = c.store<" << types[n] << " >();" << std::endl;
+        for(unsigned int b = first; b < last; b++)
+          out << phase[b].code;
+        out << "}" << std::endl;
+      }
+
+  out << std::endl
+      << "void pass(hdl::compiled &c, uint64_t time)" << std::endl
+      << "{" << std::endl;
+  for(unsigned int f = 0; f < functions; f++)
+    out << "  f" << f << "(c, time);" << std::endl;
+  out << "}" << std::endl
+      << "}" << std::endl
+      << std::endl
+      << "extern const hdl::compiled::design " << name << " =" << std::endl
+      << "  { " << g.wires.size() << ", " << g.parts.size() << ", "
+      << g.signature() << "ull, feedback, pass };" << std::endl;
+}
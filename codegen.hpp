@@ -0,0 +1,60 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+
+#ifndef CODEGEN_HPP
+#define CODEGEN_HPP
+
+#include <ostream>
+#include <string>
+#include <part.hpp>
+
+namespace hdl
+{
+  // Writes a C++ translation unit that evaluates the design of the
+  // current context without the event loop (see compiled). Parts
+  // computed by a kernel are inlined, all others are called through
+  // the part table at run time. The unit defines
+  //
+  //   extern const hdl::compiled::design <name>;
+  //
+  // and has to be compiled with the same definitions (e.g. SYMMETRIC)
+  // as the design and linked into the program elaborating it.
+  class codegen
+  {
+  private:
+    part tb;
+
+  public:
+    codegen(part testbench);
+
+    void write(std::ostream &out, const std::string &name) const;
+  };
+}
+
+#endif
@@ -0,0 +1,127 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+
+#include <cstdlib>
+#include <iostream>
+#include <compiled.hpp>
+
+using namespace hdl;
+
+namespace
+{
+  // passes per time step before giving up on a design that does not
+  // settle
+  const unsigned int max_passes = 1000;
+}
+
+compiled::compiled(part testbench, const design &d)
+  : ctx(context::current()), tb(testbench), code(d)
+{
+  ctx.freeze();
+  const detail::graph &g = ctx.flat;
+  if(g.wires.size() != d.nwires || g.parts.size() != d.nparts || g.signature() != d.signature)
+    {
+      std::cerr << "ERROR: The generated code does not match the design." << std::endl;
+      std::abort();
+    }
+  stamp.assign(g.wires.size(), 0);
+  seen.assign(g.parts.size(), 0);
+}
+
+bool compiled::rose(unsigned int w) const
+{
+  return ctx.flat.wires[w]->rose();
+}
+
+bool compiled::fell(unsigned int w) const
+{
+  return ctx.flat.wires[w]->fell();
+}
+
+void compiled::evaluate(unsigned int p, uint64_t time)
+{
+  ctx.flat.parts[p]->update(time);
+}
+
+void compiled::commit(unsigned int p, uint64_t time)
+{
+  const detail::graph &g = ctx.flat;
+  for(auto w = g.drives.first(p); w != g.drives.last(p); w++)
+    if(ctx.changed_wires.test(*w))
+      {
+        g.wires[*w]->update(time);
+        if(g.wires[*w]->differs())
+          {
+            stamp[*w] = ++now;
+            again |= code.feedback[*w];
+          }
+      }
+}
+
+// like the first time step of the simulator
+void compiled::update_all(uint64_t time)
+{
+  const detail::graph &g = ctx.flat;
+  for(unsigned int w = 0; w < g.wires.size(); w++)
+    {
+      g.wires[w]->update(time);
+      if(g.wires[w]->differs())
+        stamp[w] = ++now;
+    }
+}
+
+void compiled::run(uint64_t duration)
+{
+  context::scope bind(ctx);
+  unsigned int testbench = tb.p->id;
+
+  uint64_t end = cur_time + duration;
+  for(; cur_time < end; cur_time++)
+    {
+      ctx.delta++;
+      evaluate(testbench, cur_time);
+
+      ctx.delta++;
+      if(first)
+        update_all(cur_time);
+      else
+        commit(testbench, cur_time);
+
+      unsigned int n = 0;
+      do
+        {
+          again = false;
+          code.pass(*this, cur_time);
+          first = false;
+        }
+      while(again && ++n < max_passes);
+      if(again)
+        std::cerr << "WARNING: Design does not settle at time " << cur_time << "." << std::endl;
+    }
+}
@@ -0,0 +1,117 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+
+#ifndef COMPILED_HPP
+#define COMPILED_HPP
+
+#include <cstdint>
+#include <vector>
+#include <context.hpp>
+#include <part.hpp>
+#include <store.hpp>
+
+namespace hdl
+{
+  // Runs a design with code written by codegen instead of the event
+  // loop. Every time step the testbench runs, then the generated code
+  // evaluates the edge triggered parts (reading the values from before
+  // any of them) and the other parts in level order, and repeats as
+  // long as values feed back, e.g. into clocks. Parts without a
+  // kernel are called through the table of parts of the context.
+  //
+  // All changes in a time step share one delta cycle, so event() in
+  // parts without a kernel means "changed in this time step". The
+  // testbench runs every time step, schedule() is not supported.
+  class compiled
+  {
+  public:
+    // what codegen writes for a design
+    struct design
+    {
+      unsigned int nwires;
+      unsigned int nparts;
+      uint64_t signature;
+      const unsigned char *feedback;  // per wire: a change needs another pass
+      void (*pass)(compiled &c, uint64_t time);
+    };
+
+  private:
+    context &ctx;
+    part tb;
+    const design &code;
+    uint64_t cur_time = 0;
+
+    void update_all(uint64_t time);
+
+  public:
+    // The current context has to hold the design codegen was run on.
+    compiled(part testbench, const design &d);
+
+    void run(uint64_t duration);
+
+    // used by the generated code
+
+    // per wire: value of now when it changed last
+    std::vector<uint64_t> stamp;
+    // per part: value of now when it was evaluated last
+    std::vector<uint64_t> seen;
+    uint64_t now = 0;
+    bool first = true;
+    bool again = false;
+
+    template <typename T>
+    detail::value_store<T> &store()
+    {
+      return ctx.store<T>();
+    }
+
+    template <typename T, typename U>
+    void set(detail::value_store<T> &s, unsigned int slot, unsigned int w,
+             const U &value, bool feedback)
+    {
+      if(!(s.state[slot] == value))
+        {
+          s.prev_state[slot] = s.state[slot];
+          s.state[slot] = value;
+          s.changed_at[slot] = s.delta;
+          stamp[w] = ++now;
+          again |= feedback;
+        }
+    }
+
+    bool rose(unsigned int w) const;
+    bool fell(unsigned int w) const;
+
+    // run a part without a kernel, and update the wires it has set
+    void evaluate(unsigned int p, uint64_t time);
+    void commit(unsigned int p, uint64_t time);
+  };
+}
+
+#endif
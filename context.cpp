@@ -0,0 +1,143 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+#include <context.hpp>
+#include <kind.hpp>
+
+using namespace hdl;
+
+thread_local context *context::cur = NULL;
+
+context::~context()
+{
+}
+
+context &context::current()
+{
+  static context global;
+  return cur ? *cur : global;
+}
+
+context::scope::scope(context &ctx)
+  : outer(cur)
+{
+  cur = &ctx;
+}
+
+context::scope::~scope()
+{
+  cur = outer;
+}
+
+void context::add_wire(std::shared_ptr<detail::base> w)
+{
+  w->id = wires.size();
+  wires.push_back(w);
+  changed_wires.resize(wires.size());
+  frozen = false;
+}
+
+void context::add_part(std::shared_ptr<detail::base> p)
+{
+  p->id = parts.size();
+  parts.push_back(p);
+  frozen = false;
+}
+
+unsigned int context::new_tmp()
+{
+  return tmp_count++;
+}
+
+void context::clear()
+{
+  wires.clear();
+  parts.clear();
+  kinds.clear();
+  stores.clear();
+  changed_wires.clear();
+  tmp_count = 0;
+  delta = 0;
+  wheel = detail::event_wheel();
+  flat = detail::graph();
+  std::vector<detail::link>().swap(links);
+  frozen = false;
+}
+
+// Connections of objects that are not part of this context (anymore)
+// are dropped.
+void context::connect(detail::link::kind_t kind, const detail::base *from, const detail::base *to)
+{
+  auto known = [] (const detail::base *n, const std::vector<std::shared_ptr<detail::base> > &v)
+    {
+      return n->id < v.size() && v[n->id].get() == n;
+    };
+  bool ok = kind == detail::link::drives ?
+    known(from, parts) && known(to, wires) :
+    known(from, wires) && known(to, parts);
+  if(ok)
+    links.push_back({ kind, from->id, to->id });
+  frozen = false;
+}
+
+void context::freeze()
+{
+  if(frozen)
+    return;
+  // the driver slots are handed out anew for the rebuilt graph
+  for(auto &w : wires)
+    w->thaw();
+  for(auto &s : stores)
+    s.second->clear_drivers();
+
+  // the connections are only kept in the tables
+  std::vector<detail::link> all;
+  flat.connections(all);
+  all.insert(all.end(), links.begin(), links.end());
+  std::vector<detail::link>().swap(links);
+  flat.build(wires, parts, all);
+  for(auto &w : wires)
+    w->freeze(flat);
+  frozen = true;
+  generation++;
+}
+
+bool context::is_frozen() const
+{
+  return frozen;
+}
+
+std::size_t context::num_wires() const
+{
+  return wires.size();
+}
+
+std::size_t context::num_parts() const
+{
+  return parts.size();
+}
@@ -0,0 +1,141 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+#ifndef CONTEXT_HPP
+#define CONTEXT_HPP
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+#include <base.hpp>
+#include <graph.hpp>
+#include <store.hpp>
+#include <wheel.hpp>
+
+namespace hdl
+{
+  template <typename T>
+  class wire;
+
+  // Everything a design consists of: all wires and parts, the counter
+  // for unnamed objects and the pending wake-ups. Wires, parts and
+  // simulators bind to the current context of the thread creating
+  // them. Threads that never select a context share a default one.
+  class context
+  {
+  private:
+    static thread_local context *cur;
+
+    std::vector<std::shared_ptr<detail::base> > wires;
+    std::vector<std::shared_ptr<detail::base> > parts;
+    unsigned int tmp_count = 0;
+
+    // wire values by type and their change flags by wire id
+    std::unordered_map<std::type_index, std::unique_ptr<detail::store_base> > stores;
+
+    // parts created by make_part by kind
+    std::unordered_map<std::type_index, std::unique_ptr<detail::kind_base> > kinds;
+    detail::bitmap changed_wires;
+    uint64_t delta = 0;
+
+    detail::event_wheel wheel;
+    std::mutex wheel_mutex;
+
+    // flat copy of the design for the scheduler and the connections
+    // made since it was built
+    detail::graph flat;
+    std::vector<detail::link> links;
+    bool frozen = false;
+    unsigned int generation = 0;
+
+    void connect(detail::link::kind_t kind, const detail::base *from, const detail::base *to);
+
+    template <typename T>
+    detail::value_store<T> &store()
+    {
+      auto &s = stores[std::type_index(typeid(T))];
+      if(!s)
+        s.reset(new detail::value_store<T>(changed_wires, delta));
+      return *static_cast<detail::value_store<T>*>(s.get());
+    }
+
+    friend class simulator;
+    friend class compiled;
+    friend class codegen;
+    friend class optimizer;
+    friend class detail::archive;
+    template <typename T>
+    friend class wire;
+    friend class detail::kind_base;
+    friend class part;
+
+  public:
+    context() = default;
+    ~context();
+    context(const context&) = delete;
+    context &operator=(const context&) = delete;
+
+    static context &current();
+
+    // Makes a context the current one of the calling thread for the
+    // lifetime of the scope object.
+    class scope
+    {
+    private:
+      context *outer;
+
+    public:
+      scope(context &ctx);
+      ~scope();
+      scope(const scope&) = delete;
+      scope &operator=(const scope&) = delete;
+    };
+
+    void add_wire(std::shared_ptr<detail::base> w);
+    void add_part(std::shared_ptr<detail::base> p);
+    unsigned int new_tmp();
+
+    // Forget the whole design and the simulation state. Wires and parts
+    // created before must not be used afterwards.
+    void clear();
+
+    // End of elaboration: convert the design into flat fanout tables.
+    // Adding wires or parts afterwards is allowed, the next run will
+    // freeze again. Happens automatically on the first run.
+    void freeze();
+    bool is_frozen() const;
+
+    std::size_t num_wires() const;
+    std::size_t num_parts() const;
+  };
+}
+
+#endif
@@ -0,0 +1,253 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <hdlsim.hpp>
+
+using namespace hdl;
+
+// Compares the fixed_t division, which works on whole words, with a
+// division done one bit at a time. Operands are random, mostly small,
+// sparse or zero, for single and multi-word types, plus the extremes.
+// Also runs the div part in a simulation.
+// Exits with 1 if a quotient deviates.
+
+namespace
+{
+  unsigned int failures = 0;
+  std::mt19937_64 rng(1);
+
+  typedef std::vector<bool> bits_t;
+
+  template <bool sign, unsigned int mbits, unsigned int fbits>
+  bits_t magnitude(const fixed_t<sign, mbits, fbits> &x)
+  {
+    bits_t v(mbits + fbits);
+    for(unsigned int c = 0; c < v.size(); c++)
+      v[c] = x[c];
+    if(x.negative())
+      {
+        bool carry = true;
+        for(unsigned int c = 0; c < v.size(); c++)
+          {
+            bool b = !v[c];
+            v[c] = b != carry;
+            carry = b && carry;
+          }
+      }
+    return v;
+  }
+
+  // a >= b, with b one bit shorter
+  bool at_least(const bits_t &a, const bits_t &b)
+  {
+    if(a.back())
+      return true;
+    for(unsigned int c = b.size(); c > 0; c--)
+      if(a[c-1] != b[c-1])
+        return a[c-1];
+    return true;
+  }
+
+  void subtract(bits_t &a, const bits_t &b)
+  {
+    bool borrow = false;
+    for(unsigned int c = 0; c < a.size(); c++)
+      {
+        bool y = c < b.size() && b[c];
+        bool d = (a[c] != y) != borrow;
+        borrow = (!a[c] && (y || borrow)) || (y && borrow);
+        a[c] = d;
+      }
+  }
+
+  // The quotient of the magnitudes, with the dividend shifted so that it
+  // gets the fractional bits of the result, truncated, saturated and
+  // given the sign.
+  template <bool sign, unsigned int m1, unsigned int f1, unsigned int m2, unsigned int f2>
+  fixed_t<sign, m1+m2, f1+f2> reference(const fixed_t<sign, m1, f1> &a, const fixed_t<sign, m2, f2> &b)
+  {
+    typedef fixed_t<sign, m1+m2, f1+f2> result_t;
+    const unsigned int shift = 2*f2 + (sign ? 1 : 0);
+    bits_t n = magnitude(a);
+    n.insert(n.begin(), shift, false);
+    bits_t d = magnitude(b);
+
+    bool overflow = std::find(d.begin(), d.end(), true) == d.end();
+    bits_t q(n.size(), false);
+    bits_t r(d.size() + 1, false);
+    for(unsigned int c = n.size(); c > 0 && !overflow; c--)
+      {
+        r.insert(r.begin(), n[c-1]);
+        r.pop_back();
+        if(at_least(r, d))
+          {
+            subtract(r, d);
+            q[c-1] = true;
+          }
+      }
+
+    const unsigned int bits = m1 + m2 + f1 + f2;
+    const unsigned int top = sign ? bits - 1 : bits;
+    for(unsigned int c = top; c < q.size(); c++)
+      overflow = overflow || q[c];
+    result_t result;
+    for(unsigned int c = 0; c < bits; c++)
+      result.set(c, c < top && (overflow || (c < q.size() && q[c])));
+
+    if(a.negative() != b.negative())
+      {
+        result = -result;
+#ifndef SYMMETRIC
+        if(overflow)
+          result.set(0, false);
+#endif
+      }
+#ifdef SYMMETRIC
+    if(result.asymmetric())
+      result.set(0, true);
+#endif
+    return result;
+  }
+
+  template <bool sign, unsigned int mbits, unsigned int fbits>
+  fixed_t<sign, mbits, fbits> random()
+  {
+    fixed_t<sign, mbits, fbits> x;
+    unsigned int mode = rng() % 5;
+    for(unsigned int c = 0; c < mbits + fbits; c++)
+      switch(mode)
+        {
+        case 0: // small
+          x.set(c, c < (mbits + fbits) / 3 && (rng() & 1));
+          break;
+        case 1: // sparse
+          x.set(c, rng() % 8 == 0);
+          break;
+        case 2: // all ones but a few
+          x.set(c, rng() % 8 != 0);
+          break;
+        default:
+          x.set(c, rng() & 1);
+        }
+    if(rng() % 16 == 0)
+      x = fixed_t<sign, mbits, fbits>();
+    return x;
+  }
+
+  // zero, one step, all ones and the sign bit alone
+  template <bool sign, unsigned int mbits, unsigned int fbits>
+  std::vector<fixed_t<sign, mbits, fbits> > extremes()
+  {
+    std::vector<fixed_t<sign, mbits, fbits> > v(4);
+    v[1].set(0, true);
+    for(unsigned int c = 0; c < mbits + fbits; c++)
+      v[2].set(c, true);
+    v[3].set(mbits + fbits - 1, true);
+    return v;
+  }
+
+  template <bool sign, unsigned int m1, unsigned int f1, unsigned int m2, unsigned int f2>
+  void check(const fixed_t<sign, m1, f1> &a, const fixed_t<sign, m2, f2> &b)
+  {
+    fixed_t<sign, m1+m2, f1+f2> q = a / b;
+    fixed_t<sign, m1+m2, f1+f2> r = reference(a, b);
+    if(q.bin() != r.bin())
+      {
+        if(failures < 10)
+          std::cout << "fixed_t<" << sign << ", " << m1 << ", " << f1 << "> / fixed_t<"
+                    << sign << ", " << m2 << ", " << f2 << ">: " << a.bin() << " / " << b.bin()
+                    << " = " << q.bin() << ", expected " << r.bin() << std::endl;
+        failures++;
+      }
+  }
+
+  template <bool sign, unsigned int m1, unsigned int f1, unsigned int m2, unsigned int f2>
+  void sweep(unsigned int n = 2000)
+  {
+    for(auto &a : extremes<sign, m1, f1>())
+      for(auto &b : extremes<sign, m2, f2>())
+        check(a, b);
+    for(unsigned int c = 0; c < n; c++)
+      check(random<sign, m1, f1>(), random<sign, m2, f2>());
+  }
+
+  // the div part has to give the same quotient as the operator
+  void simulate()
+  {
+    context ctx;
+    context::scope bind(ctx);
+
+    typedef fixed_t<true, 12, 20> a_t;
+    typedef fixed_t<true, 4, 12> b_t;
+    wire<a_t> a;
+    wire<b_t> b;
+    wire<fixed_t<true, 16, 32> > q;
+    div(a, b, q);
+    part tb({}, { { a, b } }, [=] (uint64_t)
+            {
+              a = random<true, 12, 20>();
+              b = random<true, 4, 12>();
+            }, "tb");
+
+    simulator sim(tb);
+    for(unsigned int t = 0; t < 200; t++)
+      {
+        sim.run(1);
+        if(q.get().bin() != (a.get() / b.get()).bin())
+          {
+            std::cout << "div part [" << t << "]: " << q.get().bin() << ", expected "
+                      << (a.get() / b.get()).bin() << std::endl;
+            failures++;
+          }
+      }
+  }
+}
+
+int main()
+{
+  sweep<true, 4, 4, 3, 5>();
+  sweep<false, 4, 4, 3, 5>();
+  sweep<true, 2, 14, 4, 8>();
+  sweep<false, 1, 0, 1, 0>();
+  sweep<true, 2, 0, 2, 0>();
+  sweep<true, 20, 40, 10, 30>();
+  sweep<false, 30, 34, 1, 63>();
+  sweep<true, 64, 0, 64, 0>();
+  sweep<true, 70, 60, 40, 50>();
+  sweep<false, 100, 28, 64, 64>();
+  sweep<true, 1, 127, 1, 63>();
+  sweep<false, 128, 0, 65, 0>();
+  sweep<true, 3, 200, 70, 3>(500);
+  simulate();
+  std::cout << failures << " deviations" << std::endl;
+  return failures ? 1 : 0;
+}
@@ -28,9 +28,11 @@
 #ifndef FIXED_HPP
 #define FIXED_HPP
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <limits>
 #include <type_traits>
 #include <vector>
@@ -51,6 +53,11 @@ constexpr unsigned long int logceil(const type base, const type val)
   return val > 1 ? 1ul + logceil(base, val/base) : 0;
 }
 
+// native product of two words
+#if defined(__SIZEOF_INT128__) && UINTMAX_MAX == UINT64_MAX
+#define FIXED_DWORD
+#endif
+
 // fixed point arithmetic class
 template <bool sign, unsigned int mbits, unsigned int fbits>
 class fixed_t
@@ -61,39 +68,42 @@ private:
 
   // choose appropriate type
   typedef uintmax_t word_t;
+#ifdef FIXED_DWORD
+  __extension__ typedef unsigned __int128 dword_t;
+#endif
 
   // constants
   static const unsigned int word_size = sizeof(word_t)*8;
   static const unsigned int words = (bits+word_size-1)/word_size; // round up
+  // bit 0 has the weight 2^lsb, conversions ignore bit 0 of signed values
+  static const int lsb = -static_cast<int>(fbits) - (sign && mbits > 0 ? 1 : 0);
+  static const unsigned int low = sign ? 1 : 0;
 
   // storage
   std::array<word_t, words> value;
 
   template <bool sign2, unsigned int mbits2, unsigned int fbits2> friend class fixed_t;
+  template <bool sign2, unsigned int pmbits, unsigned int pfbits, unsigned int mbits2, unsigned int fbits2>
+  friend void sine_cosine(const fixed_t<sign2, pmbits, pfbits> &phase,
+                          fixed_t<true, mbits2, fbits2> &s, fixed_t<true, mbits2, fbits2> &c);
 
   // add with carry
-  inline word_t awc(word_t a, word_t b, bool &carry) const
+  static inline word_t awc(word_t a, word_t b, bool &carry)
   {
-    if(carry)
-      {
-        if(a != word_t(-1))
-          a += 1;
-        else if(b != word_t(-1))
-          b += 1;
-        else
-          return word_t(-2);
-        carry = false;
-      }
-    if(word_t(-1) - a < b)
-      carry = true;
-    else
-      carry = false;
-    return a + b;
+    word_t s = a + b;
+    word_t r = s + carry;
+    carry = s < a || r < s;
+    return r;
   }
 
   // multiply
-  inline void mul(word_t a, word_t b, word_t &h, word_t &l) const
+  static inline void mul(word_t a, word_t b, word_t &h, word_t &l)
   {
+#ifdef FIXED_DWORD
+    dword_t p = static_cast<dword_t>(a) * b;
+    l = static_cast<word_t>(p);
+    h = static_cast<word_t>(p >> word_size);
+#else
     word_t al = a & (power<word_t>(2, word_size/2)-1);
     word_t ah = (a >> word_size/2) & (power<word_t>(2, word_size/2)-1);
     word_t bl = b & (power<word_t>(2, word_size/2)-1);
@@ -120,6 +130,162 @@ private:
     h = awc(h, albh >> word_size/2, carry);
     carry = false;
     h = awc(h, ahbl >> word_size/2, carry);
+#endif
+  }
+
+  // product of two magnitudes, truncated to the size of r
+  template <std::size_t n1, std::size_t n2, std::size_t n3>
+  static void product(const std::array<word_t, n1> &a, const std::array<word_t, n2> &b,
+                      std::array<word_t, n3> &r)
+  {
+    std::array<word_t, n1+n2> p;
+    p.fill(0);
+    for(unsigned int n = 0; n < n1; n++)
+      {
+        if(a[n] == 0)
+          continue;
+        // a[n]*b[m] + p[n+m] + carry fits into two words
+        word_t carry = 0;
+        for(unsigned int m = 0; m < n2; m++)
+          {
+            word_t h, l;
+            mul(a[n], b[m], h, l);
+            bool c = false;
+            p[n+m] = awc(p[n+m], l, c);
+            h += c;
+            c = false;
+            p[n+m] = awc(p[n+m], carry, c);
+            carry = h + c;
+          }
+        p[n+n2] = carry;
+      }
+    for(unsigned int c = 0; c < n3; c++)
+      r[c] = p[c];
+  }
+
+  // the words of -x if negative, -x of an asymmetric x is ~x
+  void magnitude(std::array<word_t, words> &m) const
+  {
+    m = value;
+    if(!negative())
+      return;
+    bool carry = !asymmetric();
+    for(unsigned int c = 0; c < words; c++)
+      m[c] = ~value[c];
+    if(bits % word_size != 0)
+      m[words-1] &= (static_cast<word_t>(1) << (bits % word_size)) - 1;
+    for(unsigned int c = 0; c < words; c++)
+      m[c] = awc(m[c], 0, carry);
+  }
+
+  // two's complement of all words
+  template <std::size_t n>
+  static void negate(std::array<word_t, n> &a)
+  {
+    bool carry = true;
+    for(unsigned int c = 0; c < n; c++)
+      a[c] = awc(~a[c], 0, carry);
+  }
+
+  // Knuth's algorithm D: q = u/v, where u has m >= n digits, v has n
+  // digits and v[n-1] != 0, q gets m-n+1 digits. un and vn are scratch
+  // space of m+1 and n digits.
+  template <typename digit_t, typename ddigit_t>
+  static void divide(const digit_t *u, unsigned int m, const digit_t *v, unsigned int n,
+                     digit_t *q, digit_t *un, digit_t *vn)
+  {
+    const unsigned int b = sizeof(digit_t)*8;
+
+    if(n == 1)
+      {
+        ddigit_t r = 0;
+        for(unsigned int j = m; j-- > 0; )
+          {
+            if(r == 0)
+              {
+                q[j] = u[j] / v[0];
+                r = u[j] % v[0];
+              }
+            else
+              {
+                ddigit_t t = (r << b) | u[j];
+                q[j] = static_cast<digit_t>(t / v[0]);
+                r = t % v[0];
+              }
+          }
+        return;
+      }
+
+    // normalize, so that the top bit of the divisor is set
+    unsigned int s = 0;
+    while(!(static_cast<digit_t>(v[n-1] << s) >> (b-1)))
+      s++;
+    for(unsigned int i = n-1; i > 0; i--)
+      vn[i] = s ? (v[i] << s) | (v[i-1] >> (b-s)) : v[i];
+    vn[0] = v[0] << s;
+    un[m] = s ? u[m-1] >> (b-s) : 0;
+    for(unsigned int i = m-1; i > 0; i--)
+      un[i] = s ? (u[i] << s) | (u[i-1] >> (b-s)) : u[i];
+    un[0] = u[0] << s;
+
+    for(unsigned int j = m-n+1; j-- > 0; )
+      {
+        // estimate the quotient digit from the top digits, it is at most
+        // one too large afterwards
+        ddigit_t t = (static_cast<ddigit_t>(un[j+n]) << b) | un[j+n-1];
+        ddigit_t qhat = t / vn[n-1];
+        ddigit_t rhat = t % vn[n-1];
+        while(qhat >> b || qhat * vn[n-2] > ((rhat << b) | un[j+n-2]))
+          {
+            qhat--;
+            rhat += vn[n-1];
+            if(rhat >> b)
+              break;
+          }
+
+        // multiply and subtract
+        digit_t borrow = 0;
+        digit_t carry = 0;
+        for(unsigned int i = 0; i < n; i++)
+          {
+            ddigit_t p = qhat * vn[i] + carry;
+            carry = static_cast<digit_t>(p >> b);
+            digit_t d = un[i+j] - static_cast<digit_t>(p);
+            digit_t b1 = un[i+j] < static_cast<digit_t>(p);
+            un[i+j] = d - borrow;
+            borrow = b1 + (d < borrow);
+          }
+        digit_t d = un[j+n] - carry;
+        digit_t b1 = un[j+n] < carry;
+        un[j+n] = d - borrow;
+        borrow = b1 + (d < borrow);
+
+        q[j] = static_cast<digit_t>(qhat);
+        if(borrow)
+          {
+            // add back
+            q[j]--;
+            digit_t c = 0;
+            for(unsigned int i = 0; i < n; i++)
+              {
+                ddigit_t sum = static_cast<ddigit_t>(un[i+j]) + vn[i] + c;
+                un[i+j] = static_cast<digit_t>(sum);
+                c = static_cast<digit_t>(sum >> b);
+              }
+            un[j+n] += c;
+          }
+      }
+  }
+
+  // or a word into the value at a bit offset
+  inline void place(word_t w, unsigned int offset)
+  {
+    unsigned int n = offset / word_size;
+    unsigned int s = offset % word_size;
+    if(n < words)
+      value[n] |= w << s;
+    if(s != 0 && n+1 < words)
+      value[n+1] |= w >> (word_size - s);
   }
 
   // extend sign to fill the whole word size
@@ -165,23 +331,24 @@ public:
     for(unsigned int c = 0; c < words; c++)
       value[c] = 0;
 
-    type d;
-    if((sign && mbits >= 2) || (!sign && mbits >= 1))
-      d = std::pow<type>(2, mbits - (sign ? 2 : 1));
+    // x = m*2^e, the truncated x/2^lsb has p bits, take them from the
+    // mantissa one word at a time
+    int e;
+    type m = std::frexp(x, &e);
+    int p = e - lsb;
+    if(p > static_cast<int>(bits))
+      for(unsigned int c = low; c < bits; c++)
+        set(c, true);
     else
-      d = 0.5;
-    for(unsigned int c = 0; c < bits - (sign ? 1 : 0); c++)
-      {
-        unsigned int n = bits-c-1;
-        if(x == 0 || d == 0)
-          break;
-        else if(x >= d)
-          {
-            set(n, true);
-            x -= d;
-          }
-        d *= 0.5;
-      }
+      while(m != 0 && p > static_cast<int>(low))
+        {
+          int n = std::min<int>(word_size, p - low);
+          m = std::ldexp(m, n);
+          word_t w = static_cast<word_t>(m);
+          m -= w;
+          p -= n;
+          place(w, p);
+        }
 
     if(neg)
       *this = -*this;
@@ -194,27 +361,20 @@ public:
           fixed_t<sign, mbits, fbits>>::type *t = NULL)
   {
     bool neg = sign && x < 0;
-    if(neg)
-        x = -x;
+    uintmax_t m = neg ? -static_cast<uintmax_t>(x) : static_cast<uintmax_t>(x);
 
-    assert(x < power<type>(2, mbits - (sign ? 1 : 0)));
+    bool overflow = mbits - low < static_cast<unsigned int>(std::numeric_limits<uintmax_t>::digits) &&
+      m >> (mbits - low) != 0;
+    assert(!overflow);
 
     for(unsigned int c = 0; c < words; c++)
       value[c] = 0;
 
-    type i = power<type>(2, mbits - (sign ? 2 : 1));
-    for(unsigned int c = 0; c < bits - (sign ? 1 : 0); c++)
-      {
-        unsigned int n = bits-c-1;
-        if(x == 0 || i == 0)
-          break;
-        else if (x >= i)
-          {
-            set(n, true);
-            x -= i;
-          }
-        i /= 2;
-      }
+    if(overflow)
+      for(unsigned int c = fbits + low; c < bits; c++)
+        set(c, true);
+    else
+      place(m, fbits + low);
 
     if(neg)
       *this = -*this;
@@ -268,21 +428,32 @@ public:
     else
       tmp = *this;
 
-    long double result = 0;
-    long double d;
-    if((sign && mbits >= 2) || (!sign && mbits >= 1))
-      d = std::pow<long double>(2, mbits - (sign ? 2 : 1));
-    else
-      d = 0.5;
-    for(unsigned int c = 0; c < bits - (sign ? 1 : 0); c++)
-      {
-        unsigned int n = bits-c-1;
-        if(d == 0) // due to finite precision of type
-          break;
-        else if(tmp.at(n))
-          result += d;
-        d *= 0.5l;
-      }
+    if(sign)
+      tmp.value[0] &= ~static_cast<word_t>(1);
+
+    int n = words-1;
+    while(n >= 0 && tmp.value[n] == 0)
+      n--;
+    if(n < 0)
+      return 0;
+
+    // the two words below the highest set bit, with any bits further down
+    // in the lowest bit, are rounded correctly by a single addition
+    auto get = [&](int c) { return c >= 0 ? tmp.value[c] : 0; };
+    unsigned int s = 0;
+    while(!((tmp.value[n] << s) >> (word_size-1)))
+      s++;
+    word_t hi = s ? (get(n) << s) | (get(n-1) >> (word_size-s)) : get(n);
+    word_t lo = s ? (get(n-1) << s) | (get(n-2) >> (word_size-s)) : get(n-1);
+    bool sticky = (get(n-2) << s) != 0;
+    for(int c = 0; c < n-2; c++)
+      sticky |= tmp.value[c] != 0;
+    if(sticky)
+      lo |= 1;
+
+    int e = n*static_cast<int>(word_size) - static_cast<int>(s) + lsb;
+    long double result = std::ldexp(static_cast<long double>(hi), e) +
+      std::ldexp(static_cast<long double>(lo), e - static_cast<int>(word_size));
 
     if(neg)
       result = -result;
@@ -321,7 +492,7 @@ public:
         unsigned int d = words-c-1;
         value[d] = d >= amount_words ?
           value[d-amount_words] << amount_bits : 0;
-        value[d] |= d > amount_words ?
+        value[d] |= d > amount_words && amount_bits > 0 ?
           value[d-amount_words-1] >> (word_size - amount_bits) : 0;
         value[d] &= power<word_t>(2, word_size)-1;
       }
@@ -355,7 +526,7 @@ public:
         unsigned int d = words-c-1;
         tmp.value[d] = d >= amount_words ?
           value[d-amount_words] << amount_bits : 0;
-        tmp.value[d] |= d > amount_words ?
+        tmp.value[d] |= d > amount_words && amount_bits > 0 ?
           value[d-amount_words-1] >> (word_size - amount_bits) : 0;
         tmp.value[d] &= power<word_t>(2, word_size)-1;
       }
@@ -389,8 +560,9 @@ public:
         word_t fill = neg ? power<word_t>(2, word_size)-1 : 0;
         value[c] = (c+amount_words < words) ?
           value[c+amount_words] >> amount_bits : fill;
-        value[c] |= (c+amount_words < words-1 ? value[c+amount_words+1] : fill)
-          << (word_size - amount_bits);
+        if(amount_bits > 0)
+          value[c] |= (c+amount_words < words-1 ? value[c+amount_words+1] : fill)
+            << (word_size - amount_bits);
         value[c] &= power<word_t>(2, word_size)-1;
       }
 
@@ -421,9 +593,10 @@ public:
         word_t fill = neg ? power<word_t>(2, word_size)-1 : 0;
         tmp.value[c] = (c+amount_words < words) ?
           value[c+amount_words] >> amount_bits : fill;
-        tmp.value[c] |= (c+amount_words < words-1 ?
-                         value[c+amount_words+1] : fill)
-          << (word_size - amount_bits);
+        if(amount_bits > 0)
+          tmp.value[c] |= (c+amount_words < words-1 ?
+                           value[c+amount_words+1] : fill)
+            << (word_size - amount_bits);
         tmp.value[c] &= power<word_t>(2, word_size)-1;
       }
 
@@ -645,7 +818,7 @@ public:
     assert(sign);
     if(asymmetric())
       return ~*this;
-    static fixed_t<sign, mbits, fbits> zero;
+    fixed_t<sign, mbits, fbits> zero;
     bool borrow = false;
     return zero.diff(*this, borrow);
   }
@@ -653,41 +826,14 @@ public:
   template <unsigned int mbits2, unsigned int fbits2>
   fixed_t<sign, mbits+mbits2, fbits+fbits2> operator*(const fixed_t<sign, mbits2, fbits2> &x) const
   {
-    if(negative() && x.negative())
-      return -*this * -x;
-    else if(!negative() && x.negative())
-      return -(*this * -x);
-    else if(negative() && !x.negative())
-      return -(-*this * x);
-
-    std::array<word_t, 2*words> result;
-    std::array<word_t, 2*words> carrys;
-    for(unsigned int c = 0; c < 2*words; c++)
-      {
-        result[c] = 0;
-        carrys[c] = 0;
-      }
-
-    for(unsigned int n = 0; n < words; n++)
-      for(unsigned int m = 0; m < x.words; m++)
-        {
-          word_t a = value.at(n);
-          word_t b = x.value.at(m);
-          word_t h;
-          word_t l;
-          mul(a, b, h, l);
-          bool carry = false;
-          result[n+m] = awc(result[n+m], l, carry);
-          carrys[n+m+1] += carry;
-          carry = false;
-          result[n+m+1] = awc(result[n+m+1], h, carry);
-          carrys[n+m+2] += carry;
-        }
+    // multiply the magnitudes and fix the sign afterwards
+    std::array<word_t, words> a;
+    std::array<word_t, fixed_t<sign, mbits2, fbits2>::words> b;
+    magnitude(a);
+    x.magnitude(b);
 
     fixed_t<sign, mbits+mbits2, fbits+fbits2> tmp2;
-    bool carry = false;
-    for(unsigned int c = 0; c < tmp2.words; c++)
-      tmp2.value[c] = awc(result[c], carrys[c], carry);
+    product(a, b, tmp2.value);
 
     if(sign)
       tmp2 >>= 1;
@@ -697,13 +843,117 @@ public:
       tmp2.set(0, true);
 #endif
 
-    return tmp2;
+    return negative() != x.negative() ? -tmp2 : tmp2;
   }
 
   template <unsigned int mbits2, unsigned int fbits2>
   fixed_t<sign, mbits+mbits2, fbits+fbits2> operator/(const fixed_t<sign, mbits2, fbits2> &x) const
   {
-    return fixed_t<sign, mbits+mbits2, fbits+fbits2>(); // TODO: implement
+    // divide the magnitudes and fix the sign afterwards, the quotient is
+    // truncated and saturates if it does not fit or x is zero
+    typedef fixed_t<sign, mbits2, fbits2> divisor_t;
+    typedef fixed_t<sign, mbits+mbits2, fbits+fbits2> result_t;
+#ifdef FIXED_DWORD
+    typedef word_t digit_t;
+    typedef dword_t ddigit_t;
+#else
+    typedef uint32_t digit_t;
+    typedef uint64_t ddigit_t;
+#endif
+    const unsigned int digit_size = sizeof(digit_t)*8;
+    const unsigned int digits = word_size/digit_size;
+    // signed values have one more fractional bit than fbits
+    const unsigned int shift = 2*fbits2 + (sign ? 1 : 0);
+    const unsigned int uwords = (bits+shift+word_size-1)/word_size;
+
+    std::array<word_t, words> a = value;
+    std::array<word_t, divisor_t::words> b = x.value;
+    if(negative())
+      negate(a);
+    if(x.negative())
+      negate(b);
+    if(bits % word_size != 0)
+      a[words-1] &= (static_cast<word_t>(1) << (bits % word_size)) - 1;
+    if(divisor_t::bits % word_size != 0)
+      b[divisor_t::words-1] &= (static_cast<word_t>(1) << (divisor_t::bits % word_size)) - 1;
+
+    // split the shifted dividend and the divisor into digits
+    std::array<digit_t, uwords*digits> u;
+    std::array<digit_t, divisor_t::words*digits> v;
+    for(unsigned int c = 0; c < uwords; c++)
+      {
+        int k = static_cast<int>(c) - static_cast<int>(shift / word_size);
+        word_t w = k >= 0 && k < static_cast<int>(words) ? a[k] << (shift % word_size) : 0;
+        if(shift % word_size != 0 && k > 0 && k <= static_cast<int>(words))
+          w |= a[k-1] >> (word_size - shift % word_size);
+        for(unsigned int d = 0; d < digits; d++)
+          u[c*digits+d] = static_cast<digit_t>(w >> (d*digit_size));
+      }
+    for(unsigned int c = 0; c < divisor_t::words; c++)
+      for(unsigned int d = 0; d < digits; d++)
+        v[c*digits+d] = static_cast<digit_t>(b[c] >> (d*digit_size));
+
+    unsigned int m = u.size();
+    while(m > 0 && u[m-1] == 0)
+      m--;
+    unsigned int n = v.size();
+    while(n > 0 && v[n-1] == 0)
+      n--;
+
+    std::array<digit_t, uwords*digits> q;
+    q.fill(0);
+    bool overflow = n == 0;
+    if(!overflow && m >= n)
+      {
+        std::array<digit_t, uwords*digits+1> un;
+        std::array<digit_t, divisor_t::words*digits> vn;
+        divide<digit_t, ddigit_t>(u.data(), m, v.data(), n, q.data(), un.data(), vn.data());
+      }
+
+    // the magnitude must stay below the sign bit
+    const unsigned int top = sign ? result_t::bits-1 : result_t::bits;
+    result_t tmp;
+    for(unsigned int c = 0; c < q.size(); c++)
+      if(c/digits < result_t::words)
+        tmp.value[c/digits] |= static_cast<word_t>(q[c]) << (c%digits*digit_size);
+      else if(q[c] != 0)
+        overflow = true;
+    for(unsigned int c = 0; c < result_t::words; c++)
+      {
+        word_t mask = c*word_size >= top ? ~static_cast<word_t>(0) :
+          c*word_size + word_size > top ? ~static_cast<word_t>(0) << (top - c*word_size) : 0;
+        if(tmp.value[c] & mask)
+          overflow = true;
+      }
+
+    bool neg = negative() != x.negative();
+    if(overflow)
+      for(unsigned int c = 0; c < result_t::words; c++)
+        tmp.value[c] = c*word_size + word_size <= top ? ~static_cast<word_t>(0) :
+          c*word_size >= top ? 0 : (static_cast<word_t>(1) << (top - c*word_size)) - 1;
+    if(neg)
+      {
+        negate(tmp.value);
+#ifndef SYMMETRIC
+        if(overflow)
+          tmp.set(0, false);
+#endif
+      }
+    tmp.signext();
+
+#ifdef SYMMETRIC
+    if(tmp.asymmetric())
+      tmp.set(0, true);
+#endif
+
+    return tmp;
+  }
+
+  template <unsigned int mbits2, unsigned int fbits2>
+  fixed_t<sign, mbits, fbits> &operator/=(const fixed_t<sign, mbits2, fbits2> &x)
+  {
+    *this = (*this / x).template resize<mbits, fbits>();
+    return *this;
   }
 
   template <unsigned int mbits2, unsigned int fbits2>
@@ -737,12 +987,20 @@ public:
     return itis;
   }
 
+  // negative and bits 1 ... bits-2 clear
   inline bool asymmetric() const
   {
     if(!negative())
       return false;
-    for(unsigned int c = 0; c < bits-2; c++)
-      if(at(bits-c-2)) return false;
+    for(unsigned int c = 0; c < words; c++)
+      {
+        word_t mask = c > 0 ? ~static_cast<word_t>(0) : ~static_cast<word_t>(1);
+        if(c*word_size + word_size >= bits)
+          mask &= c*word_size + 1 >= bits ? 0 :
+            (static_cast<word_t>(1) << (bits - 1 - c*word_size)) - 1;
+        if(value[c] & mask)
+          return false;
+      }
     return true;
   }
 
@@ -0,0 +1,179 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <hdlsim.hpp>
+
+using namespace hdl;
+
+// Checks that a simulation continued from a snapshot, restored into
+// the same simulator or forked into another context, gives the same
+// values as the simulation run straight through. The design has
+// registers, a delay line, a counter, a wire with two drivers and a
+// part that schedules itself.
+// Exits with 1 if a continued run deviates.
+
+namespace
+{
+  const uint64_t ticks = 300;
+
+  // The testbench only depends on the time, its state is not part of
+  // a snapshot.
+  struct design
+  {
+    std::vector<wire<std_logic> > bits;
+    std::vector<wire<fixed_t<false, 16, 0> > > numbers;
+
+    part build()
+    {
+      wire<std_logic> clk, reset, one(1), a, b, q, shared, blink;
+      wire<fixed_t<false, 16, 0> > count, delayed;
+      counter(clk, reset, one, count);
+      delay<8>(clk, reset, one, count, delayed);
+      reg(clk, reset, one, a, q);
+      part({ a, b }, { shared }, [=] (uint64_t)
+           {
+             shared = std_logic(a) == std_logic(true) ? std_logic(b) : std_logic().z();
+           }, "drive_a");
+      part({ a, b }, { shared }, [=] (uint64_t)
+           {
+             shared = std_logic(a) == std_logic(true) ? std_logic().z() : std_logic(true);
+           }, "drive_b");
+      part({}, { blink }, [=] (uint64_t t)
+           {
+             blink = t / 7 % 2;
+             simulator::schedule(t + 7);
+           }, "blink");
+
+      bits = { clk, reset, a, b, q, shared, blink };
+      numbers = { count, delayed };
+      return part({}, { { clk, reset, a, b } }, [=] (uint64_t t)
+                  {
+                    clk = t % 2;
+                    reset = t >= 4;
+                    a = (t * 7 + t / 3) % 5 < 2;
+                    b = t % 11 < 6;
+                  }, "tb");
+    }
+
+    std::string values() const
+    {
+      std::stringstream ss;
+      for(auto &w : bits)
+        ss << std_logic(w);
+      for(auto &w : numbers)
+        ss << " " << static_cast<double>(w.get());
+      return ss.str();
+    }
+  };
+
+  unsigned int failures = 0;
+
+  void compare(const std::string &what, uint64_t t, const std::string &got,
+               const std::vector<std::string> &expected)
+  {
+    if(got != expected[t])
+      {
+        std::cout << what << " [" << t << "]: " << got << ", expected "
+                  << expected[t] << std::endl;
+        failures++;
+      }
+  }
+
+  void run(bool levelized)
+  {
+    std::string mode = levelized ? "levelized " : "event ";
+    std::vector<std::string> straight;
+    {
+      context ctx;
+      context::scope bind(ctx);
+      design d;
+      simulator sim(d.build());
+      sim.levelize(levelized);
+      for(uint64_t t = 0; t < ticks; t++)
+        {
+          sim.run(1);
+          straight.push_back(d.values());
+        }
+    }
+
+    for(uint64_t at : { 0, 1, 5, 64, 151 })
+      {
+        context ctx;
+        context::scope bind(ctx);
+        design d;
+        simulator sim(d.build());
+        sim.levelize(levelized);
+        sim.run(at);
+        snapshot_t s = sim.snapshot();
+
+        // go on, then back twice
+        for(unsigned int pass = 0; pass < 3; pass++)
+          {
+            if(pass > 0)
+              sim.restore(s);
+            for(uint64_t t = at; t < ticks; t++)
+              {
+                sim.run(1);
+                std::stringstream what;
+                what << mode << "restored at " << at << " pass " << pass;
+                compare(what.str(), t, d.values(), straight);
+              }
+          }
+
+        // a fork of the restored state and the original side by side
+        sim.restore(s);
+        context other;
+        design e;
+        simulator forked = sim.fork(other, [&] { return e.build(); });
+        for(uint64_t t = at; t < ticks; t++)
+          {
+            sim.run(1);
+            {
+              context::scope bind_other(other);
+              forked.run(1);
+            }
+            std::stringstream what;
+            what << mode << "forked at " << at;
+            compare(what.str() + " original", t, d.values(), straight);
+            compare(what.str(), t, e.values(), straight);
+          }
+      }
+  }
+}
+
+int main()
+{
+  run(false);
+  run(true);
+  std::cout << failures << " deviations" << std::endl;
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,259 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <algorithm>
+#include <limits>
+#include <graph.hpp>
+#include <kind.hpp>
+
+using namespace hdl;
+
+// rows of one kind of links, sorted by id and without duplicates
+void detail::graph::fill(csr &c, std::size_t nrows, const std::vector<link> &links,
+                         link::kind_t kind)
+{
+  c.begin.assign(nrows + 1, 0);
+  for(auto &l : links)
+    if(l.kind == kind)
+      c.begin[l.from + 1]++;
+  for(std::size_t n = 0; n < nrows; n++)
+    c.begin[n+1] += c.begin[n];
+  c.fanout.resize(c.begin[nrows]);
+  std::vector<unsigned int> pos(c.begin.begin(), c.begin.end() - 1);
+  for(auto &l : links)
+    if(l.kind == kind)
+      c.fanout[pos[l.from]++] = l.to;
+
+  unsigned int first = 0;
+  for(std::size_t n = 0; n < nrows; n++)
+    {
+      auto b = c.fanout.begin() + first;
+      auto e = c.fanout.begin() + c.begin[n+1];
+      std::sort(b, e);
+      e = std::unique(b, e);
+      first = c.begin[n+1];
+      unsigned int out = c.begin[n];
+      for(auto i = b; i != e; i++)
+        c.fanout[out++] = *i;
+      c.begin[n+1] = out;
+    }
+  c.fanout.resize(c.begin[nrows]);
+  c.fanout.shrink_to_fit();
+}
+
+void detail::graph::build(const std::vector<std::shared_ptr<base> > &all_wires,
+                          const std::vector<std::shared_ptr<base> > &all_parts,
+                          const std::vector<link> &links)
+{
+  wires.clear();
+  parts.clear();
+  for(auto &w : all_wires)
+    wires.push_back(w.get());
+  for(auto &p : all_parts)
+    parts.push_back(p.get());
+
+  kinds.assign(parts.size(), NULL);
+  members.assign(parts.size(), 0);
+  for(unsigned int p = 0; p < parts.size(); p++)
+    if(auto *k = dynamic_cast<kind_part*>(parts[p]))
+      {
+        kinds[p] = &k->get_kind();
+        members[p] = k->member();
+      }
+
+  fill(readers, wires.size(), links, link::reads);
+  fill(posedge, wires.size(), links, link::posedge);
+  fill(negedge, wires.size(), links, link::negedge);
+  fill(drives, parts.size(), links, link::drives);
+
+  // transpose drives
+  writers.begin.assign(wires.size() + 1, 0);
+  for(auto w : drives.fanout)
+    writers.begin[w+1]++;
+  for(std::size_t w = 0; w < wires.size(); w++)
+    writers.begin[w+1] += writers.begin[w];
+  writers.fanout.resize(drives.fanout.size());
+  std::vector<unsigned int> pos(writers.begin.begin(), writers.begin.end() - 1);
+  for(unsigned int p = 0; p < parts.size(); p++)
+    for(auto w = drives.first(p); w != drives.last(p); w++)
+      writers.fanout[pos[*w]++] = p;
+}
+
+// Assign every part a level such that all parts driving one of its
+// inputs have a lower level. Parts on a feedback loop (through
+// registers or combinational) end up on the same level.
+unsigned int detail::graph::rank(std::vector<unsigned int> &level) const
+{
+  const graph &g = *this;
+  unsigned int nwires = g.wires.size();
+  unsigned int nnodes = nwires + g.parts.size();
+
+  // wires are nodes 0 .. nwires-1, parts follow
+  std::vector<unsigned int> begin(1, 0);
+  std::vector<unsigned int> adj;
+  for(unsigned int w = 0; w < nwires; w++)
+    {
+      for(auto p = g.readers.first(w); p != g.readers.last(w); p++)
+        adj.push_back(nwires + *p);
+      for(auto p = g.posedge.first(w); p != g.posedge.last(w); p++)
+        adj.push_back(nwires + *p);
+      for(auto p = g.negedge.first(w); p != g.negedge.last(w); p++)
+        adj.push_back(nwires + *p);
+      begin.push_back(adj.size());
+    }
+  for(unsigned int p = 0; p < g.parts.size(); p++)
+    {
+      adj.insert(adj.end(), g.drives.first(p), g.drives.last(p));
+      begin.push_back(adj.size());
+    }
+
+  // strongly connected components (iterative Tarjan)
+  const unsigned int none = std::numeric_limits<unsigned int>::max();
+  std::vector<unsigned int> idx(nnodes, none);
+  std::vector<unsigned int> low(nnodes, 0);
+  std::vector<unsigned int> comp(nnodes, none);
+  std::vector<bool> onstack(nnodes, false);
+  std::vector<unsigned int> stack;
+  std::vector<std::pair<unsigned int, unsigned int> > call;
+  unsigned int counter = 0;
+  unsigned int ncomps = 0;
+
+  for(unsigned int s = 0; s < nnodes; s++)
+    {
+      if(idx[s] != none)
+        continue;
+      idx[s] = low[s] = counter++;
+      stack.push_back(s);
+      onstack[s] = true;
+      call.push_back(std::make_pair(s, begin[s]));
+      while(call.size() > 0)
+        {
+          unsigned int v = call.back().first;
+          if(call.back().second < begin[v+1])
+            {
+              unsigned int w = adj[call.back().second++];
+              if(idx[w] == none)
+                {
+                  idx[w] = low[w] = counter++;
+                  stack.push_back(w);
+                  onstack[w] = true;
+                  call.push_back(std::make_pair(w, begin[w]));
+                }
+              else if(onstack[w])
+                low[v] = std::min(low[v], idx[w]);
+              continue;
+            }
+          if(low[v] == idx[v])
+            {
+              unsigned int w;
+              do
+                {
+                  w = stack.back();
+                  stack.pop_back();
+                  onstack[w] = false;
+                  comp[w] = ncomps;
+                }
+              while(w != v);
+              ncomps++;
+            }
+          call.pop_back();
+          if(call.size() > 0)
+            {
+              unsigned int u = call.back().first;
+              low[u] = std::min(low[u], low[v]);
+            }
+        }
+    }
+
+  // Tarjan yields the components in reverse topological order,
+  // so walk them backwards and compute the longest path to each.
+  std::vector<std::vector<unsigned int> > members(ncomps);
+  for(unsigned int v = 0; v < nnodes; v++)
+    members[comp[v]].push_back(v);
+
+  std::vector<unsigned int> depth(ncomps, 0);
+  unsigned int maxdepth = 0;
+  for(unsigned int c = ncomps; c > 0; c--)
+    for(auto v : members[c-1])
+      for(unsigned int e = begin[v]; e < begin[v+1]; e++)
+        if(comp[adj[e]] != c-1)
+          {
+            unsigned int d = depth[c-1] + (adj[e] >= nwires ? 1 : 0);
+            if(d > depth[comp[adj[e]]])
+              depth[comp[adj[e]]] = d;
+          }
+
+  level.resize(g.parts.size());
+  for(unsigned int p = 0; p < g.parts.size(); p++)
+    {
+      level[p] = depth[comp[nwires + p]];
+      maxdepth = std::max(maxdepth, level[p]);
+    }
+  return maxdepth;
+}
+
+void detail::graph::connections(std::vector<link> &links) const
+{
+  auto rows = [&] (const csr &c, link::kind_t kind)
+    {
+      for(unsigned int n = 0; n + 1 < c.begin.size(); n++)
+        for(auto t = c.first(n); t != c.last(n); t++)
+          links.push_back({ kind, n, *t });
+    };
+  rows(readers, link::reads);
+  rows(posedge, link::posedge);
+  rows(negedge, link::negedge);
+  rows(drives, link::drives);
+}
+
+uint64_t detail::graph::signature() const
+{
+  // FNV-1a
+  uint64_t h = 14695981039346656037ull;
+  auto mix = [&h] (uint64_t x)
+    {
+      for(unsigned int c = 0; c < 8; c++)
+        {
+          h ^= (x >> (8*c)) & 0xff;
+          h *= 1099511628211ull;
+        }
+    };
+
+  mix(wires.size());
+  mix(parts.size());
+  for(auto p : parts)
+    for(char c : p->getname())
+      mix(c);
+  for(const csr *c : { &readers, &posedge, &negedge, &drives })
+    {
+      for(auto b : c->begin)
+        mix(b);
+      for(auto f : c->fanout)
+        mix(f);
+    }
+  return h;
+}
@@ -0,0 +1,107 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+#ifndef GRAPH_HPP
+#define GRAPH_HPP
+
+#include <memory>
+#include <vector>
+#include <base.hpp>
+
+namespace hdl
+{
+  namespace detail
+  {
+    // Fanout of a frozen design as compressed sparse rows: the fanout
+    // of node n are the ids fanout[begin[n]] ... fanout[begin[n+1]-1].
+    // Wires and parts are numbered by their index in the context.
+    struct csr
+    {
+      std::vector<unsigned int> begin;
+      std::vector<unsigned int> fanout;
+
+      inline const unsigned int *first(unsigned int n) const
+      {
+        return fanout.data() + begin[n];
+      }
+
+      inline const unsigned int *last(unsigned int n) const
+      {
+        return fanout.data() + begin[n+1];
+      }
+    };
+
+    // A connection made while the design is elaborated, by id: part to
+    // reads wire from (or wakes up on one of its edges), or part from
+    // drives wire to.
+    struct link
+    {
+      enum kind_t { reads, posedge, negedge, drives };
+      kind_t kind;
+      unsigned int from;
+      unsigned int to;
+    };
+
+    class graph
+    {
+    private:
+      static void fill(csr &c, std::size_t nrows, const std::vector<link> &links,
+                       link::kind_t kind);
+
+    public:
+      std::vector<base*> wires;
+      std::vector<base*> parts;
+
+      csr readers;  // wire -> level sensitive parts
+      csr posedge;  // wire -> parts woken up by a rising edge
+      csr negedge;  // wire -> parts woken up by a falling edge
+      csr drives;   // part -> wires
+      csr writers;  // wire -> parts driving it
+
+      // per part: its kind and index in it (make_part) or NULL
+      std::vector<kind_base*> kinds;
+      std::vector<unsigned int> members;
+
+      void build(const std::vector<std::shared_ptr<base> > &all_wires,
+                 const std::vector<std::shared_ptr<base> > &all_parts,
+                 const std::vector<link> &links);
+
+      // the links the tables were built from, without duplicates
+      void connections(std::vector<link> &links) const;
+
+      // Assign every part a level such that all parts driving one of
+      // its inputs have a lower level. Returns the highest level.
+      unsigned int rank(std::vector<unsigned int> &level) const;
+
+      // hash of the structure and the part names
+      uint64_t signature() const;
+    };
+  }
+}
+
+#endif
@@ -29,10 +29,19 @@
 #define HDLSIM_HPP
 
 #include <base.hpp>
+#include <context.hpp>
 #include <wire.hpp>
 #include <part.hpp>
+#include <kind.hpp>
 #include <stdlib.hpp>
 #include <std_logic.hpp>
+#include <lanes.hpp>
+#include <logic_vector.hpp>
 #include <simulator.hpp>
+#include <vcd.hpp>
+#include <wave.hpp>
+#include <compiled.hpp>
+#include <codegen.hpp>
+#include <optimizer.hpp>
 
 #endif
@@ -0,0 +1,270 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+#include <string>
+#include <fixed.hpp>
+#include <sine.hpp>
+
+namespace hdl
+{
+  // Kernels compute the stdlib primitives on plain values, so the
+  // parts (see make_part) and the code written by codegen share one
+  // implementation. eval() takes the inputs followed by references to
+  // the outputs.
+  namespace kernel
+  {
+    struct combinational
+    {
+      // the first argument of eval() is whether the first input changed
+      static const bool event = false;
+      // eval() returns whether it has written the outputs
+      static const bool conditional = false;
+      // eval() copies its input, so the output can share its value
+      static const bool alias = false;
+
+      // constructor arguments for codegen
+      std::string args() const { return ""; }
+    };
+
+    struct reg : combinational
+    {
+      static const bool event = true;
+      static const bool conditional = true;
+      static const char *name() { return "hdl::kernel::reg"; }
+
+      template <typename B, typename T>
+      static bool eval(bool event, const B &clk, const B &reset, const B &enable,
+                       const T &din, T &dout)
+      {
+        if(reset == static_cast<B>(false))
+          dout = T();
+        else if(event and clk == static_cast<B>(true)
+                and enable == static_cast<B>(true))
+          dout = din;
+        else
+          return false;
+        return true;
+      }
+    };
+
+    struct assign : combinational
+    {
+      static const bool alias = true;
+      static const char *name() { return "hdl::kernel::assign"; }
+
+      template <typename I, typename O>
+      static void eval(const I &in, O &out)
+      {
+        out = in;
+      }
+    };
+
+    struct invert : combinational
+    {
+      static const char *name() { return "hdl::kernel::invert"; }
+
+      template <typename I, typename O>
+      static void eval(const I &in, O &out)
+      {
+        out = ~in;
+      }
+    };
+
+#define KERNEL2(NAME, EXPR)                                             \
+    struct NAME : combinational                                         \
+    {                                                                   \
+      static const char *name() { return "hdl::kernel::" #NAME; }       \
+                                                                        \
+      template <typename I1, typename I2, typename O>                   \
+      static void eval(const I1 &in1, const I2 &in2, O &out)            \
+      {                                                                 \
+        out = EXPR;                                                     \
+      }                                                                 \
+    };
+
+    KERNEL2(band, in1 & in2)
+    KERNEL2(bor, in1 | in2)
+    KERNEL2(bxor, in1 ^ in2)
+    KERNEL2(plus, in1 + in2)
+    KERNEL2(minus, in1 - in2)
+    KERNEL2(mul, in1 * in2)
+    KERNEL2(div, in1 / in2)
+    KERNEL2(shift, in1 << in2)
+
+#undef KERNEL2
+
+    // in the type returned by sin() of the phase, like the sincos part
+    // has always done
+    struct sincos : combinational
+    {
+      static const char *name() { return "hdl::kernel::sincos"; }
+
+      template <bool sign, unsigned int pmbits, unsigned int pfbits,
+                unsigned int mbits, unsigned int fbits>
+      static void eval(const fixed_t<sign, pmbits, pfbits> &phase,
+                       fixed_t<true, mbits, fbits> &sin_out,
+                       fixed_t<true, mbits, fbits> &cos_out)
+      {
+        fixed_t<true, pmbits, pfbits> s, c;
+        sine_cosine(phase, s, c);
+        sin_out = s.template resize<mbits, fbits>();
+        cos_out = c.template resize<mbits, fbits>();
+      }
+    };
+
+    // barrel_shift_fixed, by a constant amount
+    struct shift_by : combinational
+    {
+      int amount;
+
+      shift_by(int amount = 0)
+        : amount(amount)
+      {
+      }
+
+      static const char *name() { return "hdl::kernel::shift_by"; }
+      std::string args() const { return std::to_string(amount); }
+
+      template <typename I, typename O>
+      void eval(const I &in, O &out) const
+      {
+        out = in << amount;
+      }
+    };
+
+    struct add : combinational
+    {
+      static const char *name() { return "hdl::kernel::add"; }
+
+      template <typename I1, typename I2, typename C, typename O, typename CO>
+      static void eval(const I1 &in1, const I2 &in2, const C &carryin,
+                       O &out, CO &carryout)
+      {
+        bool carry = carryin;
+        out = in1.sum(in2, carry);
+        carryout = carry;
+      }
+    };
+
+    // add of lanes with one carry per lane, every lane is summed a word
+    // at a time like a single fixed_t
+    struct lane_add : combinational
+    {
+      static const char *name() { return "hdl::kernel::lane_add"; }
+
+      template <typename I1, typename I2, typename C, typename O, typename CO>
+      static void eval(const I1 &in1, const I2 &in2, const C &carryin,
+                       O &out, CO &carryout)
+      {
+        for(unsigned int c = 0; c < in1.size(); c++)
+          {
+            bool carry = carryin[c];
+            decltype(out[c]) tmp;
+            tmp = in1[c].sum(in2[c], carry);
+            out.set(c, tmp);
+            carryout.set(c, carry);
+          }
+      }
+    };
+
+    struct sub : combinational
+    {
+      static const char *name() { return "hdl::kernel::sub"; }
+
+      template <typename I1, typename I2, typename C, typename O, typename CO>
+      static void eval(const I1 &in1, const I2 &in2, const C &borrowin,
+                       O &out, CO &borrowout)
+      {
+        C borrow = borrowin;
+        out = in1.diff(in2, borrow);
+        borrowout = borrow;
+      }
+    };
+
+    struct negative : combinational
+    {
+      static const char *name() { return "hdl::kernel::negative"; }
+
+      template <typename I, typename O>
+      static void eval(const I &in, O &out)
+      {
+        out = -in;
+      }
+    };
+
+    struct absolute : combinational
+    {
+      static const char *name() { return "hdl::kernel::absolute"; }
+
+      template <typename I, typename O>
+      static void eval(const I &in, O &out)
+      {
+        if(in < 0)
+          out = -in;
+        else
+          out = in;
+      }
+    };
+
+    struct resize : combinational
+    {
+      static const char *name() { return "hdl::kernel::resize"; }
+
+      template <bool sign, unsigned int mbits1, unsigned int fbits1,
+                unsigned int mbits2, unsigned int fbits2>
+      static void eval(const fixed_t<sign, mbits1, fbits1> &in,
+                       fixed_t<sign, mbits2, fbits2> &out)
+      {
+        out = in.template resize<mbits2, fbits2>();
+      }
+    };
+
+    struct compare : combinational
+    {
+      static const char *name() { return "hdl::kernel::compare"; }
+
+      template <typename I, typename B>
+      static void eval(const I &in1, const I &in2, B &equal, B &smaller, B &greater,
+                       B &unequal, B &smallerequal, B &greaterequal)
+      {
+        equal = in1 == in2;
+        smaller = in1 < in2;
+        greater = in1 > in2;
+        unequal = in1 != in2;
+        smallerequal = in1 <= in2;
+        greaterequal = in1 >= in2;
+      }
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,417 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+
+#ifndef KIND_HPP
+#define KIND_HPP
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <typeindex>
+#include <vector>
+#include <base.hpp>
+#include <context.hpp>
+#include <fixed.hpp>
+#include <lanes.hpp>
+#include <logic_vector.hpp>
+#include <part.hpp>
+#include <std_logic.hpp>
+#include <wire.hpp>
+
+namespace hdl
+{
+  namespace detail
+  {
+    // A part that is computed by a kernel (see kernels.hpp), which
+    // lets codegen evaluate it without calling the part.
+    struct kernel_info
+    {
+      struct port
+      {
+        base *w;
+        std::string (*type)();  // C++ name of the value type, empty if unknown
+      };
+
+      const char *name;
+      std::string args;
+      bool event;
+      bool conditional;
+      unsigned int inputs;
+      std::vector<port> ports;  // inputs, then outputs
+    };
+
+    // C++ name of a value type for generated code, empty if unknown
+    template <typename T>
+    struct type_name
+    {
+      static std::string get() { return ""; }
+    };
+
+#define TYPE_NAME(T)                                    \
+    template <>                                         \
+    struct type_name<T>                                 \
+    {                                                   \
+      static std::string get() { return #T; }           \
+    };
+
+    TYPE_NAME(bool)
+    TYPE_NAME(int8_t)
+    TYPE_NAME(uint8_t)
+    TYPE_NAME(int16_t)
+    TYPE_NAME(uint16_t)
+    TYPE_NAME(int32_t)
+    TYPE_NAME(uint32_t)
+    TYPE_NAME(int64_t)
+    TYPE_NAME(uint64_t)
+    TYPE_NAME(std_logic)
+
+#undef TYPE_NAME
+
+    template <bool sign, unsigned int mbits, unsigned int fbits>
+    struct type_name<fixed_t<sign, mbits, fbits> >
+    {
+      static std::string get()
+      {
+        return "fixed_t<" + std::string(sign ? "true" : "false") + ", "
+          + std::to_string(mbits) + ", " + std::to_string(fbits) + ">";
+      }
+    };
+
+    template <unsigned int width>
+    struct type_name<logic_vector<width> >
+    {
+      static std::string get()
+      {
+        return "hdl::logic_vector<" + std::to_string(width) + ">";
+      }
+    };
+
+    template <typename T, unsigned int N>
+    struct type_name<lanes<T, N> >
+    {
+      static std::string get()
+      {
+        std::string t = type_name<T>::get();
+        return t == "" ? "" : "hdl::lanes<" + t + ", " + std::to_string(N) + ">";
+      }
+    };
+
+    // compile time lists of tuple indices
+    template <unsigned int... N>
+    struct indices
+    {
+    };
+
+    template <unsigned int N, unsigned int... S>
+    struct make_indices : make_indices<N-1, N-1, S...>
+    {
+    };
+
+    template <unsigned int... S>
+    struct make_indices<0, S...>
+    {
+      typedef indices<S...> type;
+    };
+
+    // All parts computed by one kernel with the same port types. The
+    // scheduler evaluates the members of a kind that are due in one
+    // call, without std::function or a virtual call per part.
+    class kind_base
+    {
+    public:
+      // index in the kinds of the context
+      unsigned int id = 0;
+
+      virtual ~kind_base() { }
+
+      // the kind K of a context, created on first use
+      template <typename K>
+      static K &of(context &ctx)
+      {
+        auto &k = ctx.kinds[std::type_index(typeid(K))];
+        if(!k)
+          {
+            k.reset(new K());
+            k->id = ctx.kinds.size() - 1;
+          }
+        return *static_cast<K*>(k.get());
+      }
+
+      virtual void eval(const unsigned int *members, std::size_t n, uint64_t time) = 0;
+      virtual kernel_info describe(unsigned int member) const = 0;
+
+      // whether the output of every member is a copy of its input
+      virtual bool alias() const = 0;
+
+      // let another part evaluate a member, see fused_part
+      virtual void rebind(unsigned int member, base *node) = 0;
+
+    protected:
+      static void begin(base *node)
+      {
+        base::cur_part = node;
+      }
+
+      static void end(base *node)
+      {
+        base::cur_part = NULL;
+        node->set_changed(false);
+      }
+    };
+
+    template <typename K, typename I, typename O>
+    class kind;
+
+    template <typename K, typename... I, typename... O>
+    class kind<K, std::tuple<I...>, std::tuple<O...> > : public kind_base
+    {
+    private:
+      struct member
+      {
+        K kernel;
+        base *node;
+        std::tuple<wire<I>...> inputs;
+        std::tuple<wire<O>...> outputs;
+      };
+
+      std::vector<member> members;
+
+      typedef typename make_indices<sizeof...(I)>::type in_indices;
+      typedef typename make_indices<sizeof...(O)>::type out_indices;
+
+      template <typename... A>
+      static bool invoke(std::true_type, const K &k, A&&... a)
+      {
+        return k.eval(std::forward<A>(a)...);
+      }
+
+      template <typename... A>
+      static bool invoke(std::false_type, const K &k, A&&... a)
+      {
+        k.eval(std::forward<A>(a)...);
+        return true;
+      }
+
+      typedef std::integral_constant<bool, K::conditional> conditional;
+
+      // the first argument of an edge triggered kernel is the event
+      // of its first input
+      template <unsigned int... A, unsigned int... B>
+      static bool call(std::true_type, const member &m, std::tuple<O...> &result,
+                       indices<A...>, indices<B...>)
+      {
+        return invoke(conditional(), m.kernel, std::get<0>(m.inputs).event(),
+                      std::get<A>(m.inputs).get()..., std::get<B>(result)...);
+      }
+
+      template <unsigned int... A, unsigned int... B>
+      static bool call(std::false_type, const member &m, std::tuple<O...> &result,
+                       indices<A...>, indices<B...>)
+      {
+        return invoke(conditional(), m.kernel,
+                      std::get<A>(m.inputs).get()..., std::get<B>(result)...);
+      }
+
+      template <unsigned int... B>
+      static void write(const member &m, const std::tuple<O...> &result, indices<B...>)
+      {
+        int dummy[] = { (std::get<B>(m.outputs) = std::get<B>(result), 0)... };
+        (void)dummy;
+      }
+
+      template <typename T>
+      static kernel_info::port port(const wire<T> &w)
+      {
+        return { std::shared_ptr<base>(w).get(), &type_name<T>::get };
+      }
+
+      template <unsigned int... A, unsigned int... B>
+      static std::vector<kernel_info::port> ports(const member &m, indices<A...>, indices<B...>)
+      {
+        return { port(std::get<A>(m.inputs))..., port(std::get<B>(m.outputs))... };
+      }
+
+    public:
+      unsigned int size() const
+      {
+        return members.size();
+      }
+
+      void add(const K &kernel, base *node,
+               const std::tuple<wire<I>...> &inputs,
+               const std::tuple<wire<O>...> &outputs)
+      {
+        members.push_back({ kernel, node, inputs, outputs });
+      }
+
+      virtual void eval(const unsigned int *ms, std::size_t n, uint64_t)
+      {
+        for(std::size_t c = 0; c < n; c++)
+          {
+            const member &m = members[ms[c]];
+            begin(m.node);
+            std::tuple<O...> result;
+            if(call(std::integral_constant<bool, K::event>(), m, result,
+                    in_indices(), out_indices()))
+              write(m, result, out_indices());
+            end(m.node);
+          }
+      }
+
+      virtual kernel_info describe(unsigned int n) const
+      {
+        const member &m = members[n];
+        kernel_info k;
+        k.name = K::name();
+        k.args = m.kernel.args();
+        k.event = K::event;
+        k.conditional = K::conditional;
+        k.inputs = sizeof...(I);
+        k.ports = ports(m, in_indices(), out_indices());
+        return k;
+      }
+
+      virtual void rebind(unsigned int n, base *node)
+      {
+        members[n].node = node;
+      }
+
+      virtual bool alias() const
+      {
+        return K::alias and std::is_same<std::tuple<I...>, std::tuple<O...> >::value
+          and sizeof...(I) == 1;
+      }
+    };
+
+    // The part of a kind member in the design.
+    class kind_part : public base
+    {
+    private:
+      kind_base &k;
+      unsigned int m;
+
+      virtual void update(uint64_t time)
+      {
+        k.eval(&m, 1, time);
+      }
+
+    public:
+      kind_part(kind_base &k, unsigned int member)
+        : k(k), m(member)
+      {
+      }
+
+      kind_base &get_kind() const { return k; }
+      unsigned int member() const { return m; }
+    };
+
+    // A chain of kind members evaluated as one part. The wires between
+    // them are updated right away instead of in the next delta cycle,
+    // nobody else reads them.
+    class fused_part : public base
+    {
+    private:
+      struct step
+      {
+        kind_base *k;
+        unsigned int m;
+        std::vector<base*> inner;  // outputs read by later steps
+      };
+
+      std::vector<step> steps;
+
+      virtual void update(uint64_t time)
+      {
+        for(auto &s : steps)
+          {
+            s.k->eval(&s.m, 1, time);
+            for(auto w : s.inner)
+              w->update(time);
+          }
+      }
+
+    public:
+      fused_part(std::string name)
+      {
+        setname(name);
+      }
+
+      // members have to be added in the order of evaluation
+      void add(kind_base &k, unsigned int member, std::vector<base*> inner)
+      {
+        k.rebind(member, this);
+        steps.push_back({ &k, member, inner });
+      }
+    };
+
+    template <typename... T, unsigned int... N>
+    std::list<std::shared_ptr<base> > wires_of(const std::tuple<wire<T>...> &t, indices<N...>)
+    {
+      return { std::shared_ptr<base>(std::get<N>(t))... };
+    }
+
+    template <typename... T>
+    std::list<std::shared_ptr<base> > wires_of(const std::tuple<wire<T>...> &t)
+    {
+      return wires_of(t, typename make_indices<sizeof...(T)>::type());
+    }
+  }
+
+  // A part computed by K::eval (see kernels.hpp) on the values of the
+  // inputs, woken up by the given edges and sensitivity list.
+  template <typename K, typename... I, typename... O>
+  part make_part(std::list<edge> edges,
+                 std::list<std::list<std::shared_ptr<detail::base> > > sensitivity,
+                 std::tuple<wire<I>...> inputs,
+                 std::tuple<wire<O>...> outputs,
+                 K kernel = K(),
+                 std::string name = "unknown")
+  {
+    typedef detail::kind<K, std::tuple<I...>, std::tuple<O...> > kind_t;
+    kind_t &k = detail::kind_base::of<kind_t>(context::current());
+    std::shared_ptr<detail::base> node(new detail::kind_part(k, k.size()));
+    k.add(kernel, node.get(), inputs, outputs);
+    return part(edges, sensitivity, { detail::wires_of(outputs) }, node, name);
+  }
+
+  // A combinational part, sensitive to all inputs.
+  template <typename K, typename... I, typename... O>
+  part make_part(std::tuple<wire<I>...> inputs,
+                 std::tuple<wire<O>...> outputs,
+                 K kernel = K(),
+                 std::string name = "unknown")
+  {
+    return make_part({}, { detail::wires_of(inputs) }, inputs, outputs, kernel, name);
+  }
+}
+
+#endif
@@ -0,0 +1,390 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+#ifndef LANES_HPP
+#define LANES_HPP
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <base.hpp>
+#include <std_logic.hpp>
+
+namespace hdl
+{
+  // N independent copies of a value, one per stimulus lane. All
+  // operators work lane by lane, so a netlist built on wires of lanes
+  // simulates N scenarios in a single run.
+  template <typename T, unsigned int N>
+  class lanes
+  {
+  private:
+    static_assert(N > 0, "N > 0");
+    std::array<T, N> value;
+
+  public:
+    lanes()
+    {
+      value.fill(T());
+    }
+
+    // same value in all lanes
+    lanes(const T &t)
+    {
+      value.fill(t);
+    }
+
+    lanes(const std::array<T, N> &a)
+      : value(a)
+    {
+    }
+
+    // access
+
+    inline T at(unsigned int n) const
+    {
+      return value.at(n);
+    }
+
+    inline T operator[](unsigned int n) const
+    {
+      return at(n);
+    }
+
+    inline void set(unsigned int n, const T &t)
+    {
+      value.at(n) = t;
+    }
+
+    inline unsigned int size() const
+    {
+      return N;
+    }
+
+    // comparison operators (whole value)
+
+    bool operator==(const lanes<T, N> &x) const
+    {
+      for(unsigned int c = 0; c < N; c++)
+        if(!(value[c] == x.value[c]))
+          return false;
+      return true;
+    }
+
+    inline bool operator!=(const lanes<T, N> &x) const
+    {
+      return !(*this == x);
+    }
+
+    // lane-wise operators
+
+#define LANES_OPERATOR1(OP)                                     \
+    template <typename U = T>                                   \
+    lanes<decltype(OP U()), N> operator OP() const              \
+    {                                                           \
+      lanes<decltype(OP U()), N> result;                        \
+      for(unsigned int c = 0; c < N; c++)                       \
+        result.set(c, OP value[c]);                             \
+      return result;                                            \
+    }
+
+    LANES_OPERATOR1(!)
+    LANES_OPERATOR1(~)
+    LANES_OPERATOR1(+)
+    LANES_OPERATOR1(-)
+
+#define LANES_OPERATOR2(OP)                                             \
+    template <typename U>                                               \
+    lanes<decltype(T() OP U()), N> operator OP(const lanes<U, N> &x) const \
+    {                                                                   \
+      lanes<decltype(T() OP U()), N> result;                            \
+      for(unsigned int c = 0; c < N; c++)                               \
+        result.set(c, value[c] OP x.at(c));                             \
+      return result;                                                    \
+    }
+
+    LANES_OPERATOR2(&)
+    LANES_OPERATOR2(|)
+    LANES_OPERATOR2(^)
+    LANES_OPERATOR2(+)
+    LANES_OPERATOR2(-)
+    LANES_OPERATOR2(*)
+    LANES_OPERATOR2(/)
+    LANES_OPERATOR2(%)
+  };
+
+  // std_logic lanes are kept in two bit planes of 64 lanes per word:
+  //   high: val=1 unk=0, low: val=0 unk=0, Z: val=0 unk=1, U: val=1 unk=1
+  // so every gate is a handful of word-wide bit operations.
+  template <unsigned int N>
+  class lanes<std_logic, N>
+  {
+  private:
+    static_assert(N > 0, "N > 0");
+    static const unsigned int words = (N+63)/64;
+    std::array<uint64_t, words> val;
+    std::array<uint64_t, words> unk;
+
+    template <typename, unsigned int> friend class lanes;
+    template <unsigned int M>
+    friend lanes<std_logic, M> resolve(const std::map<detail::base*, lanes<std_logic, M> > &,
+                                       const detail::base *);
+
+    // unused bits of the last word
+    static inline uint64_t mask(unsigned int word)
+    {
+      return (word < words-1 || N % 64 == 0) ? ~uint64_t(0) : (uint64_t(1) << (N % 64)) - 1;
+    }
+
+    // result of a gate: known lanes get v, all others become U
+    inline void known(unsigned int c, uint64_t k, uint64_t v)
+    {
+      val[c] = ((v & k) | ~k) & mask(c);
+      unk[c] = ~k & mask(c);
+    }
+
+  public:
+    lanes()
+    {
+      for(unsigned int c = 0; c < words; c++)
+        {
+          val[c] = mask(c);
+          unk[c] = mask(c);
+        }
+    }
+
+    lanes(const std_logic &t)
+    {
+      char ch = t;
+      for(unsigned int c = 0; c < words; c++)
+        {
+          val[c] = (ch == '1' || ch == 'U') ? mask(c) : 0;
+          unk[c] = (ch == 'Z' || ch == 'U') ? mask(c) : 0;
+        }
+    }
+
+    lanes(bool b)
+      : lanes(std_logic(b))
+    {
+    }
+
+    lanes(const std::array<std_logic, N> &a)
+    {
+      for(unsigned int c = 0; c < N; c++)
+        set(c, a[c]);
+    }
+
+    // access
+
+    std_logic at(unsigned int n) const
+    {
+      assert(n < N);
+      bool v = (val[n/64] >> (n % 64)) & 1;
+      bool u = (unk[n/64] >> (n % 64)) & 1;
+      std_logic result;
+      if(!u)
+        result = v;
+      else if(!v)
+        result = result.z();
+      return result;
+    }
+
+    inline std_logic operator[](unsigned int n) const
+    {
+      return at(n);
+    }
+
+    void set(unsigned int n, const std_logic &t)
+    {
+      assert(n < N);
+      char ch = t;
+      uint64_t bit = uint64_t(1) << (n % 64);
+      if(ch == '1' || ch == 'U')
+        val[n/64] |= bit;
+      else
+        val[n/64] &= ~bit;
+      if(ch == 'Z' || ch == 'U')
+        unk[n/64] |= bit;
+      else
+        unk[n/64] &= ~bit;
+    }
+
+    inline unsigned int size() const
+    {
+      return N;
+    }
+
+    // comparison operators (whole value)
+
+    bool operator==(const lanes<std_logic, N> &x) const
+    {
+      return val == x.val && unk == x.unk;
+    }
+
+    inline bool operator!=(const lanes<std_logic, N> &x) const
+    {
+      return !(*this == x);
+    }
+
+    // lane-wise operators, same truth tables as std_logic
+
+    lanes<std_logic, N> operator!() const
+    {
+      lanes<std_logic, N> result;
+      for(unsigned int c = 0; c < words; c++)
+        result.known(c, ~unk[c], ~val[c]);
+      return result;
+    }
+
+    inline lanes<std_logic, N> operator~() const
+    {
+      return operator!();
+    }
+
+    inline lanes<std_logic, N> operator+() const
+    {
+      return *this;
+    }
+
+    inline lanes<std_logic, N> operator-() const
+    {
+      return operator!();
+    }
+
+    lanes<std_logic, N> operator&(const lanes<std_logic, N> &x) const
+    {
+      lanes<std_logic, N> result;
+      for(unsigned int c = 0; c < words; c++)
+        result.known(c, ~unk[c] & ~x.unk[c], val[c] & x.val[c]);
+      return result;
+    }
+
+    lanes<std_logic, N> operator|(const lanes<std_logic, N> &x) const
+    {
+      lanes<std_logic, N> result;
+      for(unsigned int c = 0; c < words; c++)
+        result.known(c, ~unk[c] & ~x.unk[c], val[c] | x.val[c]);
+      return result;
+    }
+
+    lanes<std_logic, N> operator^(const lanes<std_logic, N> &x) const
+    {
+      lanes<std_logic, N> result;
+      for(unsigned int c = 0; c < words; c++)
+        result.known(c, ~unk[c] & ~x.unk[c], val[c] ^ x.val[c]);
+      return result;
+    }
+
+    inline lanes<std_logic, N> operator+(const lanes<std_logic, N> &x) const
+    {
+      return operator^(x);
+    }
+
+    inline lanes<std_logic, N> operator-(const lanes<std_logic, N> &x) const
+    {
+      return operator^(x);
+    }
+
+    inline lanes<std_logic, N> operator*(const lanes<std_logic, N> &x) const
+    {
+      return operator&(x);
+    }
+
+    lanes<std_logic, N> operator/(const lanes<std_logic, N> &x) const
+    {
+      lanes<std_logic, N> result;
+      for(unsigned int c = 0; c < words; c++)
+        result.known(c, ~unk[c] & ~x.unk[c] & x.val[c], val[c]);
+      return result;
+    }
+
+    lanes<std_logic, N> operator%(const lanes<std_logic, N> &x) const
+    {
+      lanes<std_logic, N> result;
+      for(unsigned int c = 0; c < words; c++)
+        result.known(c, ~unk[c] & ~x.unk[c] & x.val[c], 0);
+      return result;
+    }
+  };
+
+  template <typename T, unsigned int N>
+  std::ostream &operator<<(std::ostream &os, const lanes<T, N> &l)
+  {
+    os << "{";
+    for(unsigned int c = 0; c < N; c++)
+      os << (c > 0 ? ", " : "") << l[c];
+    os << "}";
+    return os;
+  }
+
+  template <unsigned int N>
+  std::ostream &operator<<(std::ostream &os, const lanes<std_logic, N> &l)
+  {
+    for(unsigned int c = 0; c < N; c++)
+      os << l[N-c-1];
+    return os;
+  }
+
+#ifdef MULTIASSIGN
+  // lane-wise version of the std_logic resolution
+  template <unsigned int N>
+  lanes<std_logic, N> resolve(const std::map<detail::base*, lanes<std_logic, N> > &candidates,
+                              const detail::base *w)
+  {
+    const unsigned int words = (N+63)/64;
+    lanes<std_logic, N> result = std_logic().z();
+    std::array<uint64_t, words> conflict;
+    conflict.fill(0);
+    for(auto &i : candidates)
+      for(unsigned int c = 0; c < words; c++)
+        {
+          // lanes driven by this candidate
+          uint64_t driven = ~(i.second.unk[c] & ~i.second.val[c]) & lanes<std_logic, N>::mask(c);
+          uint64_t taken = ~(result.unk[c] & ~result.val[c]) & lanes<std_logic, N>::mask(c);
+          conflict[c] |= driven & taken;
+          result.val[c] = (result.val[c] & ~driven) | (i.second.val[c] & driven);
+          result.unk[c] = (result.unk[c] & ~driven) | (i.second.unk[c] & driven);
+        }
+    bool warn = false;
+    for(unsigned int c = 0; c < words; c++)
+      {
+        result.val[c] |= conflict[c];
+        result.unk[c] |= conflict[c];
+        warn = warn || conflict[c];
+      }
+    if(warn)
+      std::cerr << "WARNING: wire " << w->getname()
+                << " has been updated by several parts in the same lanes" << std::endl;
+    return result;
+  }
+#endif
+}
+
+#endif
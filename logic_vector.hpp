@@ -0,0 +1,450 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+
+#ifndef LOGIC_VECTOR_HPP
+#define LOGIC_VECTOR_HPP
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <type_traits>
+#include <base.hpp>
+#include <std_logic.hpp>
+
+namespace hdl
+{
+  // A vector of std_logic packed into words, so that a whole bus is
+  // a single wire. Uses the same bit planes as lanes<std_logic, N>:
+  //   high: val=1 unk=0, low: val=0 unk=0, Z: val=0 unk=1, U: val=1 unk=1
+  // Bitwise operators work bit by bit, arithmetic treats the vector
+  // as an unsigned number modulo 2^width and yields all U if any bit
+  // of an operand is not 0 or 1.
+  template <unsigned int width>
+  class logic_vector
+  {
+  private:
+    static_assert(width > 0, "width > 0");
+    static const unsigned int words = (width+63)/64;
+    std::array<uint64_t, words> val;
+    std::array<uint64_t, words> unk;
+
+    template <unsigned int> friend class logic_vector;
+    template <unsigned int M>
+    friend logic_vector<M> resolve(const std::map<detail::base*, logic_vector<M> > &,
+                                   const detail::base *);
+
+    // unused bits of the last word
+    static inline uint64_t mask(unsigned int word)
+    {
+      return (word < words-1 || width % 64 == 0) ? ~uint64_t(0) : (uint64_t(1) << (width % 64)) - 1;
+    }
+
+    // result of a gate: known bits get v, all others become U
+    inline void known(unsigned int c, uint64_t k, uint64_t v)
+    {
+      val[c] = ((v & k) | ~k) & mask(c);
+      unk[c] = ~k & mask(c);
+    }
+
+    static logic_vector<width> undefined()
+    {
+      return logic_vector<width>();
+    }
+
+    static logic_vector<width> from_words(const std::array<uint64_t, words> &w)
+    {
+      logic_vector<width> result;
+      for(unsigned int c = 0; c < words; c++)
+        {
+          result.val[c] = w[c] & mask(c);
+          result.unk[c] = 0;
+        }
+      return result;
+    }
+
+    // 64 bits of a bit plane starting at bit n (zero outside)
+    static uint64_t bits(const std::array<uint64_t, words> &plane, long n)
+    {
+      if(n <= -64 || n >= 64l*words)
+        return 0;
+      if(n < 0)
+        return plane[0] << -n;
+      unsigned int w = n/64, b = n%64;
+      uint64_t result = plane[w] >> b;
+      if(b != 0 && w + 1 < words)
+        result |= plane[w + 1] << (64 - b);
+      return result;
+    }
+
+  public:
+    // all bits U
+    logic_vector()
+    {
+      for(unsigned int c = 0; c < words; c++)
+        {
+          val[c] = mask(c);
+          unk[c] = mask(c);
+        }
+    }
+
+    // all bits the same
+    logic_vector(const std_logic &t)
+    {
+      char ch = t;
+      for(unsigned int c = 0; c < words; c++)
+        {
+          val[c] = (ch == '1' || ch == 'U') ? mask(c) : 0;
+          unk[c] = (ch == 'Z' || ch == 'U') ? mask(c) : 0;
+        }
+    }
+
+    // a number in two's complement (truncated to width)
+    template <typename U, typename = typename std::enable_if<std::is_integral<U>::value &&
+                                                             !std::is_same<U, bool>::value>::type>
+    logic_vector(U u)
+    {
+      for(unsigned int c = 0; c < words; c++)
+        {
+          val[c] = (c == 0 ? static_cast<uint64_t>(u) : u < 0 ? ~uint64_t(0) : 0) & mask(c);
+          unk[c] = 0;
+        }
+    }
+
+    logic_vector(const std::array<std_logic, width> &a)
+    {
+      for(unsigned int c = 0; c < width; c++)
+        set(c, a[c]);
+    }
+
+    static logic_vector<width> z()
+    {
+      return logic_vector<width>(std_logic().z());
+    }
+
+    // bit access
+
+    std_logic at(unsigned int n) const
+    {
+      assert(n < width);
+      bool v = (val[n/64] >> (n % 64)) & 1;
+      bool u = (unk[n/64] >> (n % 64)) & 1;
+      std_logic result;
+      if(!u)
+        result = v;
+      else if(!v)
+        result = result.z();
+      return result;
+    }
+
+    inline std_logic operator[](unsigned int n) const
+    {
+      return at(n);
+    }
+
+    void set(unsigned int n, const std_logic &t)
+    {
+      assert(n < width);
+      char ch = t;
+      uint64_t bit = uint64_t(1) << (n % 64);
+      if(ch == '1' || ch == 'U')
+        val[n/64] |= bit;
+      else
+        val[n/64] &= ~bit;
+      if(ch == 'Z' || ch == 'U')
+        unk[n/64] |= bit;
+      else
+        unk[n/64] &= ~bit;
+    }
+
+    inline unsigned int size() const
+    {
+      return width;
+    }
+
+    // slices, bits hi downto lo
+
+    template <unsigned int hi, unsigned int lo>
+    logic_vector<hi-lo+1> slice() const
+    {
+      static_assert(hi >= lo && hi < width, "lo <= hi < width");
+      logic_vector<hi-lo+1> result;
+      for(unsigned int c = 0; c < result.words; c++)
+        {
+          result.val[c] = bits(val, lo + 64l*c) & result.mask(c);
+          result.unk[c] = bits(unk, lo + 64l*c) & result.mask(c);
+        }
+      return result;
+    }
+
+    template <unsigned int hi, unsigned int lo>
+    void set_slice(const logic_vector<hi-lo+1> &v)
+    {
+      static_assert(hi >= lo && hi < width, "lo <= hi < width");
+      for(unsigned int c = 0; c < hi-lo+1; c++)
+        set(lo + c, v.at(c));
+    }
+
+    // the same vector with all other bits high-Z, for parts that
+    // drive only a slice of a bus
+    template <unsigned int hi, unsigned int lo>
+    static logic_vector<width> only(const logic_vector<hi-lo+1> &v)
+    {
+      logic_vector<width> result = z();
+      result.template set_slice<hi, lo>(v);
+      return result;
+    }
+
+    // value as a number
+
+    bool is_known() const
+    {
+      for(unsigned int c = 0; c < words; c++)
+        if(unk[c])
+          return false;
+      return true;
+    }
+
+    // lower 64 bits, only meaningful if is_known()
+    uint64_t to_uint() const
+    {
+      return val[0];
+    }
+
+    // comparison operators (whole value)
+
+    bool operator==(const logic_vector<width> &x) const
+    {
+      return val == x.val && unk == x.unk;
+    }
+
+    inline bool operator!=(const logic_vector<width> &x) const
+    {
+      return !(*this == x);
+    }
+
+    bool operator<(const logic_vector<width> &x) const
+    {
+      if(!is_known() || !x.is_known())
+        return false;
+      for(unsigned int c = words; c > 0; c--)
+        if(val[c-1] != x.val[c-1])
+          return val[c-1] < x.val[c-1];
+      return false;
+    }
+
+    inline bool operator>(const logic_vector<width> &x) const
+    {
+      return x < *this;
+    }
+
+    inline bool operator<=(const logic_vector<width> &x) const
+    {
+      return is_known() && x.is_known() && !(x < *this);
+    }
+
+    inline bool operator>=(const logic_vector<width> &x) const
+    {
+      return x <= *this;
+    }
+
+    // bitwise operators, same truth tables as std_logic
+
+    logic_vector<width> operator~() const
+    {
+      logic_vector<width> result;
+      for(unsigned int c = 0; c < words; c++)
+        result.known(c, ~unk[c], ~val[c]);
+      return result;
+    }
+
+    inline logic_vector<width> operator!() const
+    {
+      return operator~();
+    }
+
+    logic_vector<width> operator&(const logic_vector<width> &x) const
+    {
+      logic_vector<width> result;
+      for(unsigned int c = 0; c < words; c++)
+        result.known(c, ~unk[c] & ~x.unk[c], val[c] & x.val[c]);
+      return result;
+    }
+
+    logic_vector<width> operator|(const logic_vector<width> &x) const
+    {
+      logic_vector<width> result;
+      for(unsigned int c = 0; c < words; c++)
+        result.known(c, ~unk[c] & ~x.unk[c], val[c] | x.val[c]);
+      return result;
+    }
+
+    logic_vector<width> operator^(const logic_vector<width> &x) const
+    {
+      logic_vector<width> result;
+      for(unsigned int c = 0; c < words; c++)
+        result.known(c, ~unk[c] & ~x.unk[c], val[c] ^ x.val[c]);
+      return result;
+    }
+
+    // shifts fill in 0
+
+    logic_vector<width> operator<<(unsigned int n) const
+    {
+      logic_vector<width> result(0);
+      for(unsigned int c = 0; c < words; c++)
+        {
+          result.val[c] = bits(val, 64l*c - n) & mask(c);
+          result.unk[c] = bits(unk, 64l*c - n) & mask(c);
+        }
+      return result;
+    }
+
+    logic_vector<width> operator>>(unsigned int n) const
+    {
+      logic_vector<width> result(0);
+      for(unsigned int c = 0; c < words; c++)
+        {
+          result.val[c] = bits(val, 64l*c + n) & mask(c);
+          result.unk[c] = bits(unk, 64l*c + n) & mask(c);
+        }
+      return result;
+    }
+
+    // arithmetic operators
+
+    logic_vector<width> operator+(const logic_vector<width> &x) const
+    {
+      if(!is_known() || !x.is_known())
+        return undefined();
+      std::array<uint64_t, words> sum;
+      uint64_t carry = 0;
+      for(unsigned int c = 0; c < words; c++)
+        {
+          uint64_t s = val[c] + carry;
+          carry = s < carry;
+          sum[c] = s + x.val[c];
+          carry += sum[c] < s;
+        }
+      return from_words(sum);
+    }
+
+    logic_vector<width> operator-() const
+    {
+      return ~*this + logic_vector<width>(1);
+    }
+
+    inline logic_vector<width> operator+() const
+    {
+      return *this;
+    }
+
+    inline logic_vector<width> operator-(const logic_vector<width> &x) const
+    {
+      return *this + -x;
+    }
+
+    logic_vector<width> operator*(const logic_vector<width> &x) const
+    {
+      if(!is_known() || !x.is_known())
+        return undefined();
+      // schoolbook on 32 bit digits, only the lower width bits
+      const unsigned int digits = 2*words;
+      std::array<uint64_t, digits> a, b, p;
+      for(unsigned int c = 0; c < words; c++)
+        {
+          a[2*c] = val[c] & 0xffffffff;
+          a[2*c+1] = val[c] >> 32;
+          b[2*c] = x.val[c] & 0xffffffff;
+          b[2*c+1] = x.val[c] >> 32;
+        }
+      p.fill(0);
+      for(unsigned int i = 0; i < digits; i++)
+        {
+          uint64_t carry = 0;
+          for(unsigned int j = 0; i + j < digits; j++)
+            {
+              uint64_t t = a[i] * b[j] + p[i+j] + carry;
+              p[i+j] = t & 0xffffffff;
+              carry = t >> 32;
+            }
+        }
+      std::array<uint64_t, words> prod;
+      for(unsigned int c = 0; c < words; c++)
+        prod[c] = p[2*c] | (p[2*c+1] << 32);
+      return from_words(prod);
+    }
+
+  };
+
+  template <unsigned int width>
+  std::ostream &operator<<(std::ostream &os, const logic_vector<width> &v)
+  {
+    for(unsigned int c = 0; c < width; c++)
+      os << v[width-c-1];
+    return os;
+  }
+
+#ifdef MULTIASSIGN
+  // bit by bit version of the std_logic resolution
+  template <unsigned int width>
+  logic_vector<width> resolve(const std::map<detail::base*, logic_vector<width> > &candidates,
+                              const detail::base *w)
+  {
+    const unsigned int words = (width+63)/64;
+    logic_vector<width> result = logic_vector<width>::z();
+    std::array<uint64_t, words> conflict;
+    conflict.fill(0);
+    for(auto &i : candidates)
+      for(unsigned int c = 0; c < words; c++)
+        {
+          // bits driven by this candidate
+          uint64_t driven = ~(i.second.unk[c] & ~i.second.val[c]) & logic_vector<width>::mask(c);
+          uint64_t taken = ~(result.unk[c] & ~result.val[c]) & logic_vector<width>::mask(c);
+          conflict[c] |= driven & taken;
+          result.val[c] = (result.val[c] & ~driven) | (i.second.val[c] & driven);
+          result.unk[c] = (result.unk[c] & ~driven) | (i.second.unk[c] & driven);
+        }
+    bool warn = false;
+    for(unsigned int c = 0; c < words; c++)
+      {
+        result.val[c] |= conflict[c];
+        result.unk[c] |= conflict[c];
+        warn = warn || conflict[c];
+      }
+    if(warn)
+      std::cerr << "WARNING: wire " << w->getname()
+                << " has been driven by several parts on the same bits" << std::endl;
+    return result;
+  }
+#endif
+}
+
+#endif
@@ -0,0 +1,160 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <lz.hpp>
+
+using namespace hdl;
+
+namespace
+{
+  const unsigned int min_match = 4;
+  const unsigned int hash_bits = 14;
+  const std::size_t max_offset = 65535;
+
+  inline uint32_t read32(const char *p)
+  {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  inline unsigned int hash(uint32_t v)
+  {
+    return (v * 2654435761u) >> (32 - hash_bits);
+  }
+
+  // lengths of 15 and more continue in bytes of up to 255
+  inline void put_length(std::string &out, std::size_t n)
+  {
+    for(; n >= 255; n -= 255)
+      out += static_cast<char>(255);
+    out += static_cast<char>(n);
+  }
+
+  void put_sequence(std::string &out, const char *lit, std::size_t nlit,
+                    std::size_t offset, std::size_t len)
+  {
+    std::size_t ml = len >= min_match ? len - min_match : 0;
+    out += static_cast<char>(((nlit < 15 ? nlit : 15) << 4) | (ml < 15 ? ml : 15));
+    if(nlit >= 15)
+      put_length(out, nlit - 15);
+    out.append(lit, nlit);
+    if(len == 0)
+      return;
+    out += static_cast<char>(offset & 0xff);
+    out += static_cast<char>(offset >> 8);
+    if(ml >= 15)
+      put_length(out, ml - 15);
+  }
+}
+
+void detail::lz_compress(const char *in, std::size_t size, std::string &out)
+{
+  std::vector<uint32_t> table(1 << hash_bits, 0);
+  std::size_t anchor = 0;
+  std::size_t pos = 0;
+
+  // the table holds positions + 1, 0 is empty
+  while(size >= min_match && pos + min_match <= size)
+    {
+      uint32_t v = read32(in + pos);
+      unsigned int h = hash(v);
+      std::size_t cand = table[h];
+      table[h] = pos + 1;
+      if(cand == 0 || pos - (cand - 1) > max_offset || read32(in + cand - 1) != v)
+        {
+          pos++;
+          continue;
+        }
+      cand--;
+
+      std::size_t len = min_match;
+      while(pos + len < size && in[cand + len] == in[pos + len])
+        len++;
+      put_sequence(out, in + anchor, pos - anchor, pos - cand, len);
+      pos += len;
+      anchor = pos;
+    }
+  put_sequence(out, in + anchor, size - anchor, 0, 0);
+}
+
+bool detail::lz_decompress(const char *in, std::size_t in_size,
+                           char *out, std::size_t size)
+{
+  const unsigned char *ip = reinterpret_cast<const unsigned char*>(in);
+  const unsigned char *iend = ip + in_size;
+  std::size_t op = 0;
+
+  while(ip < iend)
+    {
+      unsigned int token = *ip++;
+
+      std::size_t nlit = token >> 4;
+      if(nlit == 15)
+        do
+          {
+            if(ip >= iend)
+              return false;
+            nlit += *ip;
+          }
+        while(*ip++ == 255);
+      if(nlit > static_cast<std::size_t>(iend - ip) || nlit > size - op)
+        return false;
+      std::memcpy(out + op, ip, nlit);
+      ip += nlit;
+      op += nlit;
+      if(ip == iend)
+        break;
+
+      if(iend - ip < 2)
+        return false;
+      std::size_t offset = ip[0] | (ip[1] << 8);
+      ip += 2;
+      std::size_t len = (token & 15);
+      if(len == 15)
+        do
+          {
+            if(ip >= iend)
+              return false;
+            len += *ip;
+          }
+        while(*ip++ == 255);
+      len += min_match;
+      if(offset == 0 || offset > op || len > size - op)
+        return false;
+
+      // byte by byte, matches may overlap
+      for(std::size_t c = 0; c < len; c++, op++)
+        out[op] = out[op - offset];
+    }
+  return op == size;
+}
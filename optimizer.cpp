@@ -0,0 +1,387 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#include <algorithm>
+#include <numeric>
+#include <context.hpp>
+#include <kind.hpp>
+#include <optimizer.hpp>
+
+using namespace hdl;
+
+void optimizer::fuse(bool on)
+{
+  fusing = on;
+}
+
+void optimizer::run()
+{
+  context &ctx = context::current();
+  ctx.freeze();
+  const detail::graph &g = ctx.flat;
+  unsigned int nw = g.wires.size();
+  unsigned int np = g.parts.size();
+  counts = statistics();
+  counts.wires = nw;
+  counts.parts = np;
+
+  auto writers = [&] (unsigned int w)
+    {
+      return static_cast<unsigned int>(g.writers.last(w) - g.writers.first(w));
+    };
+
+  // ports of the parts computed by a kernel
+  std::vector<char> kernel(np, false);
+  std::vector<char> pure(np, false);
+  std::vector<std::vector<unsigned int> > ins(np);
+  std::vector<std::vector<unsigned int> > outs(np);
+  for(unsigned int p = 0; p < np; p++)
+    if(g.kinds[p])
+      {
+        detail::kernel_info k = g.kinds[p]->describe(g.members[p]);
+        kernel[p] = true;
+        pure[p] = !k.event;
+        for(unsigned int c = 0; c < k.ports.size(); c++)
+          {
+            detail::base *w = k.ports[c].w;
+            if(w->id >= nw || g.wires[w->id] != w)
+              kernel[p] = false;
+            else
+              (c < k.inputs ? ins : outs)[p].push_back(w->id);
+          }
+      }
+
+  std::vector<char> observed(nw, false);
+  for(unsigned int w = 0; w < nw; w++)
+    observed[w] = g.wires[w]->named();
+  for(auto &w : kept)
+    if(w->id < nw && g.wires[w->id] == w.get())
+      observed[w->id] = true;
+
+  std::vector<char> part_gone(np, false);
+  std::vector<char> wire_gone(nw, false);
+
+  // assigns: the output becomes an alias of the root of the input
+  std::vector<unsigned int> root(nw);
+  std::iota(root.begin(), root.end(), 0);
+  auto find = [&] (unsigned int w)
+    {
+      while(root[w] != w)
+        w = root[w] = root[root[w]];
+      return w;
+    };
+
+  for(unsigned int p = 0; p < np; p++)
+    if(kernel[p] and g.kinds[p]->alias())
+      {
+        unsigned int a = find(ins[p][0]);
+        unsigned int b = outs[p][0];
+        if(a == b or observed[b] or writers(b) != 1 or g.wires[b]->resolved())
+          continue;
+        root[b] = a;
+        wire_gone[b] = true;
+        part_gone[p] = true;
+        counts.aliased++;
+      }
+
+  for(unsigned int w = 0; w < nw; w++)
+    if(wire_gone[w])
+      {
+        detail::base *b = g.wires[w];
+        detail::base *a = g.wires[find(w)];
+        b->alias(a);
+      }
+
+  // Constants are the wires nobody drives. Their value is the one
+  // assigned during elaboration, so update them once. An observed
+  // wire may be set by a part that does not list it.
+  std::vector<char> constant(nw, false);
+  for(unsigned int w = 0; w < nw; w++)
+    if(!wire_gone[w] and !observed[w] and writers(w) == 0)
+      {
+        constant[w] = true;
+        g.wires[w]->update(0);
+      }
+
+  // parts with constant inputs, drivers before the parts they drive
+  std::vector<unsigned int> level;
+  g.rank(level);
+  std::vector<unsigned int> order(np);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&] (unsigned int a, unsigned int b)
+                   {
+                     return level[a] < level[b];
+                   });
+
+  for(unsigned int p : order)
+    {
+      if(part_gone[p] or !kernel[p] or !pure[p])
+        continue;
+      bool fold = true;
+      for(unsigned int w : ins[p])
+        fold = fold and constant[find(w)];
+      for(unsigned int w : outs[p])
+        fold = fold and writers(w) == 1 and !g.wires[w]->resolved();
+      if(!fold)
+        continue;
+      g.kinds[p]->eval(&g.members[p], 1, 0);
+      for(unsigned int w : outs[p])
+        {
+          g.wires[w]->update(0);
+          g.wires[w]->hold();
+          constant[w] = true;
+        }
+      part_gone[p] = true;
+      counts.folded++;
+    }
+
+  // parts whose outputs nobody reads, which may leave their inputs
+  // without readers
+  std::vector<unsigned int> readers(nw, 0);
+  for(unsigned int p = 0; p < np; p++)
+    if(!part_gone[p] and kernel[p])
+      for(unsigned int w : ins[p])
+        readers[find(w)]++;
+  for(const detail::csr *c : { &g.readers, &g.posedge, &g.negedge })
+    for(unsigned int w = 0; w < nw; w++)
+      for(const unsigned int *p = c->first(w); p != c->last(w); p++)
+        if(!part_gone[*p] and !kernel[*p])
+          readers[find(w)]++;
+
+  std::vector<unsigned int> todo;
+  for(unsigned int p = np; p > 0; p--)
+    if(!part_gone[p-1] and kernel[p-1])
+      todo.push_back(p-1);
+  while(todo.size() > 0)
+    {
+      unsigned int p = todo.back();
+      todo.pop_back();
+      if(part_gone[p])
+        continue;
+      bool dead = true;
+      for(unsigned int w : outs[p])
+        dead = dead and !observed[w] and readers[w] == 0;
+      if(!dead)
+        continue;
+      part_gone[p] = true;
+      counts.dead++;
+      for(unsigned int w : ins[p])
+        {
+          unsigned int r = find(w);
+          if(--readers[r] == 0 and !observed[r])
+            for(const unsigned int *q = g.writers.first(r); q != g.writers.last(r); q++)
+              if(kernel[*q])
+                todo.push_back(*q);
+        }
+    }
+
+  // wires left without drivers and readers
+  for(unsigned int w = 0; w < nw; w++)
+    {
+      if(wire_gone[w] or observed[w] or readers[w] > 0)
+        continue;
+      bool driven = false;
+      for(const unsigned int *p = g.writers.first(w); p != g.writers.last(w); p++)
+        driven = driven or !part_gone[*p];
+      wire_gone[w] = !driven;
+    }
+
+  // Chains: a wire written by one pure part and read by exactly one
+  // other one is updated by the fused part right after it is written.
+  std::vector<std::vector<unsigned int> > sensitive(np);
+  std::vector<std::vector<unsigned int> > level_readers(nw);
+  std::vector<char> edge_read(nw, false);
+  std::vector<char> edge(np, false);
+  for(unsigned int w = 0; w < nw; w++)
+    {
+      for(const unsigned int *p = g.readers.first(w); p != g.readers.last(w); p++)
+        if(!part_gone[*p])
+          {
+            sensitive[*p].push_back(find(w));
+            level_readers[find(w)].push_back(*p);
+          }
+      for(const detail::csr *c : { &g.posedge, &g.negedge })
+        for(const unsigned int *p = c->first(w); p != c->last(w); p++)
+          if(!part_gone[*p])
+            edge_read[find(w)] = edge[*p] = true;
+    }
+
+  auto chainable = [&] (unsigned int p)
+    {
+      return !part_gone[p] and kernel[p] and pure[p] and !edge[p];
+    };
+
+  std::vector<unsigned int> chain(np);
+  std::iota(chain.begin(), chain.end(), 0);
+  auto head = [&] (unsigned int p)
+    {
+      while(chain[p] != p)
+        p = chain[p] = chain[chain[p]];
+      return p;
+    };
+
+  std::vector<char> inner(nw, false);
+  for(unsigned int w = 0; fusing and w < nw; w++)
+    {
+      if(wire_gone[w] or observed[w] or readers[w] != 1 or edge_read[w]
+         or level_readers[w].size() != 1 or writers(w) != 1 or g.wires[w]->resolved())
+        continue;
+      unsigned int from = *g.writers.first(w);
+      unsigned int to = level_readers[w][0];
+      if(from == to or !chainable(from) or !chainable(to))
+        continue;
+      bool input = false;
+      for(unsigned int i : ins[to])
+        input = input or find(i) == w;
+      if(!input)
+        continue;
+      inner[w] = true;
+      chain[head(from)] = head(to);
+    }
+
+  std::vector<std::vector<unsigned int> > chains(np);
+  for(unsigned int p = 0; p < np; p++)
+    if(chainable(p))
+      chains[head(p)].push_back(p);
+
+  std::vector<std::shared_ptr<detail::base> > fused(np);
+  std::vector<unsigned int> fused_into(np, np);
+  std::vector<char> done(nw, false);
+  for(auto &c : chains)
+    {
+      if(c.size() < 2)
+        continue;
+      std::stable_sort(c.begin(), c.end(), [&] (unsigned int a, unsigned int b)
+                       {
+                         return level[a] < level[b];
+                       });
+
+      // a loop through the chain has no order of evaluation
+      bool ordered = true;
+      for(unsigned int p : c)
+        {
+          for(unsigned int i : ins[p])
+            ordered = ordered and (!inner[find(i)] or done[find(i)]);
+          for(unsigned int o : outs[p])
+            done[o] = true;
+        }
+      for(unsigned int p : c)
+        for(unsigned int o : outs[p])
+          done[o] = false;
+      if(!ordered)
+        continue;
+
+      std::string name;
+      for(unsigned int p : c)
+        name += (name == "" ? "" : "+") + g.parts[p]->getname();
+      std::shared_ptr<detail::fused_part> f(new detail::fused_part(name));
+      for(unsigned int p : c)
+        {
+          std::vector<detail::base*> in;
+          for(unsigned int o : outs[p])
+            if(inner[o])
+              in.push_back(g.wires[o]);
+          f->add(*g.kinds[p], g.members[p], in);
+          fused_into[p] = c[0];
+          part_gone[p] = true;
+        }
+      fused[c[0]] = f;
+      counts.fused += c.size();
+      counts.chains++;
+    }
+
+  // renumber what is left
+  std::vector<std::shared_ptr<detail::base> > parts;
+  for(unsigned int p = 0; p < np; p++)
+    if(fused[p])
+      {
+        fused[p]->id = parts.size();
+        parts.push_back(fused[p]);
+      }
+    else if(!part_gone[p])
+      {
+        ctx.parts[p]->id = parts.size();
+        parts.push_back(ctx.parts[p]);
+      }
+
+  std::vector<std::shared_ptr<detail::base> > wires;
+  std::vector<unsigned int> changed;
+  for(unsigned int w = 0; w < nw; w++)
+    if(!wire_gone[w])
+      {
+        if(ctx.changed_wires.test(w))
+          changed.push_back(wires.size());
+        ctx.wires[w]->id = wires.size();
+        wires.push_back(ctx.wires[w]);
+      }
+  ctx.changed_wires.clear();
+  for(unsigned int w : changed)
+    ctx.changed_wires.set(w);
+
+  // The connections of what is left, by the new ids. Readers of an
+  // alias read its root, a fused part reads and drives what its members
+  // did except for the wires inside the chain.
+  std::vector<detail::link> links;
+  const detail::link::kind_t kinds[] = { detail::link::reads, detail::link::posedge, detail::link::negedge };
+  const detail::csr *rows[] = { &g.readers, &g.posedge, &g.negedge };
+  for(unsigned int c = 0; c < 3; c++)
+    for(unsigned int w = 0; w < nw; w++)
+      if(!wire_gone[find(w)])
+        for(const unsigned int *p = rows[c]->first(w); p != rows[c]->last(w); p++)
+          if(!part_gone[*p])
+            links.push_back({ kinds[c], g.wires[find(w)]->id, g.parts[*p]->id });
+  for(unsigned int p = 0; p < np; p++)
+    if(!part_gone[p] or fused_into[p] < np)
+      {
+        unsigned int id = part_gone[p] ? fused[fused_into[p]]->id : g.parts[p]->id;
+        for(const unsigned int *w = g.drives.first(p); w != g.drives.last(p); w++)
+          if(!wire_gone[*w])
+            links.push_back({ detail::link::drives, id, g.wires[*w]->id });
+        if(part_gone[p])
+          for(unsigned int w : sensitive[p])
+            if(!inner[w])
+              links.push_back({ detail::link::reads, g.wires[w]->id, id });
+      }
+
+  counts.parts_removed = np - parts.size();
+  counts.wires_removed = nw - wires.size();
+  ctx.parts.swap(parts);
+  ctx.wires.swap(wires);
+  ctx.links.swap(links);
+  ctx.flat = detail::graph();
+  ctx.frozen = false;
+}
+
+void optimizer::report(std::ostream &out) const
+{
+  out << "Removed " << counts.parts_removed << " of " << counts.parts << " parts and "
+      << counts.wires_removed << " of " << counts.wires << " wires: "
+      << counts.aliased << " assigns aliased, "
+      << counts.folded << " parts with constant inputs, "
+      << counts.dead << " parts without observers, "
+      << counts.fused << " parts fused into " << counts.chains << " chains." << std::endl;
+}
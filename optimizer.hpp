@@ -0,0 +1,100 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <base.hpp>
+#include <wire.hpp>
+
+namespace hdl
+{
+  // Simplifies the design of the current context before it is
+  // simulated or compiled:
+  //
+  // - a wire driven only by an assign from a wire of the same type
+  //   shares the value of that wire,
+  // - parts computed by a kernel (see make_part) whose inputs are
+  //   constant are evaluated once, their outputs keep the result,
+  // - parts computed by a kernel whose outputs are not observed are
+  //   removed,
+  // - chains of parts computed by a kernel that are connected by
+  //   wires nobody else reads or observes become one part, which
+  //   takes one delta cycle instead of one per part.
+  //
+  // A wire is observed if a part is sensitive to it, if it has been
+  // named or if it is kept. Wires read by a part that does not list
+  // them (e.g. a testbench checking results) have to be named or
+  // kept. The same holds for wires written by a part that does not
+  // list them as outputs: a wire without a listed writer is taken as a
+  // constant unless it is observed. Other parts are never removed. Has
+  // to run before the first simulation step, a snapshot can only be
+  // restored into a design optimized the same way.
+  class optimizer
+  {
+  public:
+    struct statistics
+    {
+      unsigned int parts = 0;          // before optimizing
+      unsigned int wires = 0;
+      unsigned int aliased = 0;        // assigns replaced by aliases
+      unsigned int folded = 0;         // parts with constant inputs
+      unsigned int dead = 0;           // parts without observers
+      unsigned int fused = 0;          // parts merged into chains
+      unsigned int chains = 0;
+      unsigned int parts_removed = 0;
+      unsigned int wires_removed = 0;
+    };
+
+  private:
+    std::vector<std::shared_ptr<detail::base> > kept;
+    bool fusing = true;
+    statistics counts;
+
+  public:
+    // never alias or remove w
+    template <typename T>
+    void keep(const wire<T> &w)
+    {
+      kept.push_back(w);
+    }
+
+    // Merge chains of parts (default). codegen evaluates a merged
+    // chain through the part table instead of inlining its kernels.
+    void fuse(bool on = true);
+
+    void run();
+
+    const statistics &stats() const { return counts; }
+    void report(std::ostream &out = std::cerr) const;
+  };
+}
+
+#endif
@@ -26,16 +26,13 @@
  *****************************************************************************/
 
 #include <part.hpp>
+#include <context.hpp>
 
 using namespace hdl;
 
-detail::part_int::part_int(std::list<std::list<std::shared_ptr<detail::base> > > outputs,
-                           std::function<void(uint64_t)> logic)
+detail::part_int::part_int(std::function<void(uint64_t)> logic)
   : logic(logic)
 {
-  for(auto &l : outputs)
-    for(auto &w : l)
-      children.insert(w);
 }
 
 void detail::part_int::update(uint64_t time)
@@ -50,11 +47,35 @@ part::part(std::list<std::list<std::shared_ptr<detail::base> > > inputs,
            std::list<std::list<std::shared_ptr<detail::base> > > outputs,
            std::function<void(uint64_t)> logic,
            std::string name)
-  : p(new detail::part_int(outputs, logic))
+  : part({}, inputs, outputs, std::make_shared<detail::part_int>(logic), name)
+{
+}
+
+part::part(std::list<edge> edges,
+           std::list<std::list<std::shared_ptr<detail::base> > > inputs,
+           std::list<std::list<std::shared_ptr<detail::base> > > outputs,
+           std::function<void(uint64_t)> logic,
+           std::string name)
+  : part(edges, inputs, outputs, std::make_shared<detail::part_int>(logic), name)
+{
+}
+
+part::part(std::list<edge> edges,
+           std::list<std::list<std::shared_ptr<detail::base> > > inputs,
+           std::list<std::list<std::shared_ptr<detail::base> > > outputs,
+           std::shared_ptr<detail::base> node,
+           std::string name)
+  : p(node)
 {
   p->setname(name);
+  context &ctx = context::current();
+  ctx.add_part(p);
   for(auto &l : inputs)
     for(auto &w : l)
-      w->children.insert(p);
-  detail::parts.push_back(p);
+      ctx.connect(detail::link::reads, w.get(), p.get());
+  for(auto &l : outputs)
+    for(auto &w : l)
+      ctx.connect(detail::link::drives, p.get(), w.get());
+  for(auto &e : edges)
+    ctx.connect(e.rising ? detail::link::posedge : detail::link::negedge, e.w.get(), p.get());
 }
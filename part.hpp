@@ -42,17 +42,35 @@ namespace hdl
       virtual void update(uint64_t time);
       
     public:
-      part_int(std::list<std::list<std::shared_ptr<detail::base> > > outputs,
-               std::function<void(uint64_t)> logic);
+      part_int(std::function<void(uint64_t)> logic);
     };
   }
 
   class simulator;
 
+  // sensitivity to one edge of a wire
+  struct edge
+  {
+    std::shared_ptr<detail::base> w;
+    bool rising;
+  };
+
+  inline edge posedge(std::shared_ptr<detail::base> w)
+  {
+    return edge{ w, true };
+  }
+
+  inline edge negedge(std::shared_ptr<detail::base> w)
+  {
+    return edge{ w, false };
+  }
+
   class part
   {
-    std::shared_ptr<detail::part_int> p;
+    std::shared_ptr<detail::base> p;
     friend class simulator;
+    friend class compiled;
+    friend class codegen;
 
   public:
     part(std::list<std::list<std::shared_ptr<detail::base> > > inputs,
@@ -60,6 +78,21 @@ namespace hdl
          std::function<void(uint64_t)> logic,
          std::string name = "unknown");
 
+    // Edge triggered part: woken up by the given edges and by changes
+    // of the (level sensitive) inputs, e.g. an asynchronous reset.
+    part(std::list<edge> edges,
+         std::list<std::list<std::shared_ptr<detail::base> > > inputs,
+         std::list<std::list<std::shared_ptr<detail::base> > > outputs,
+         std::function<void(uint64_t)> logic,
+         std::string name = "unknown");
+
+    // A part computed by node (see make_part).
+    part(std::list<edge> edges,
+         std::list<std::list<std::shared_ptr<detail::base> > > inputs,
+         std::list<std::list<std::shared_ptr<detail::base> > > outputs,
+         std::shared_ptr<detail::base> node,
+         std::string name);
+
     part() = default;
   };
 }
@@ -0,0 +1,153 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+#include <pool.hpp>
+
+using namespace hdl;
+
+detail::thread_pool::thread_pool(unsigned int nthreads)
+{
+  if(nthreads < 1)
+    nthreads = 1;
+  for(unsigned int c = 0; c < nthreads; c++)
+    queues.push_back(std::unique_ptr<queue>(new queue));
+  for(unsigned int c = 1; c < nthreads; c++)
+    threads.push_back(std::thread(&thread_pool::worker, this, c));
+}
+
+detail::thread_pool::~thread_pool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  wake.notify_all();
+  for(auto &t : threads)
+    t.join();
+}
+
+unsigned int detail::thread_pool::size() const
+{
+  return queues.size();
+}
+
+bool detail::thread_pool::take(unsigned int self, std::size_t &task)
+{
+  // own queue first
+  {
+    queue &q = *queues[self];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if(q.tasks.size() > 0)
+      {
+        task = q.tasks.front();
+        q.tasks.pop_front();
+        return true;
+      }
+  }
+
+  // then steal from the others
+  for(unsigned int c = 1; c < queues.size(); c++)
+    {
+      queue &q = *queues[(self + c) % queues.size()];
+      std::lock_guard<std::mutex> lock(q.mutex);
+      if(q.tasks.size() > 0)
+        {
+          task = q.tasks.back();
+          q.tasks.pop_back();
+          return true;
+        }
+    }
+
+  return false;
+}
+
+void detail::thread_pool::work(unsigned int self)
+{
+  std::size_t task;
+  while(take(self, task))
+    job(task);
+}
+
+void detail::thread_pool::worker(unsigned int self)
+{
+  uint64_t seen = 0;
+  while(true)
+    {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [&] { return stop || generation != seen; });
+        if(stop)
+          return;
+        seen = generation;
+      }
+
+      work(self);
+
+      // only the last one wakes up the caller
+      bool last;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        last = --active == 0;
+      }
+      if(last)
+        done.notify_one();
+    }
+}
+
+void detail::thread_pool::run(std::size_t ntasks, std::function<void(std::size_t)> fn)
+{
+  if(threads.size() == 0)
+    {
+      for(std::size_t c = 0; c < ntasks; c++)
+        fn(c);
+      return;
+    }
+
+  // distribute contiguous blocks of tasks
+  for(unsigned int c = 0; c < queues.size(); c++)
+    {
+      std::size_t begin = ntasks * c / queues.size();
+      std::size_t end = ntasks * (c+1) / queues.size();
+      std::lock_guard<std::mutex> lock(queues[c]->mutex);
+      for(std::size_t t = begin; t < end; t++)
+        queues[c]->tasks.push_back(t);
+    }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    job = fn;
+    active = threads.size();
+    generation++;
+  }
+  wake.notify_all();
+
+  work(0);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait(lock, [&] { return active == 0; });
+}
@@ -0,0 +1,84 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+#ifndef POOL_HPP
+#define POOL_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hdl
+{
+  namespace detail
+  {
+    // Work-stealing thread pool. Tasks are numbered 0..n-1 and handed
+    // out in contiguous blocks; idle workers steal from the back of
+    // the other workers' queues. The calling thread takes part, too.
+    class thread_pool
+    {
+    private:
+      struct queue
+      {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+      };
+
+      std::vector<std::thread> threads;
+      std::vector<std::unique_ptr<queue> > queues;
+      std::function<void(std::size_t)> job;
+
+      std::mutex mutex;
+      std::condition_variable wake;
+      std::condition_variable done;
+      uint64_t generation = 0;
+      unsigned int active = 0;
+      bool stop = false;
+
+      bool take(unsigned int self, std::size_t &task);
+      void work(unsigned int self);
+      void worker(unsigned int self);
+
+    public:
+      thread_pool(unsigned int nthreads);
+      ~thread_pool();
+
+      unsigned int size() const;
+
+      // run fn(0) ... fn(ntasks-1) and wait for all of them
+      void run(std::size_t ntasks, std::function<void(std::size_t)> fn);
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,178 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <graph.hpp>
+#include <profile.hpp>
+
+using namespace hdl;
+
+void detail::profiler::resize(std::size_t nparts, std::size_t nwires)
+{
+  evals.resize(nparts);
+  wasted.resize(nparts);
+  ticks.resize(nparts);
+  changes.resize(nwires);
+}
+
+void detail::profiler::step(uint64_t time, uint64_t ndeltas)
+{
+  steps++;
+  deltas += ndeltas;
+  if(ndeltas > max_deltas)
+    {
+      max_deltas = ndeltas;
+      max_deltas_time = time;
+    }
+}
+
+void detail::profiler::share(const unsigned int *parts, std::size_t n, uint64_t t)
+{
+  if(n == 0)
+    return;
+  for(std::size_t c = 0; c < n; c++)
+    ticks[parts[c]] += t / n;
+  ticks[parts[0]] += t % n;
+}
+
+namespace
+{
+  struct row
+  {
+    std::string name;
+    uint64_t parts = 0;
+    uint64_t evals = 0;
+    uint64_t wasted = 0;
+    uint64_t ticks = 0;
+  };
+
+  void print(std::ostream &out, const row &r, double seconds_per_tick, uint64_t total)
+  {
+    out << "  " << std::left << std::setw(24) << r.name << std::right
+        << std::setw(8) << r.parts
+        << std::setw(14) << r.evals
+        << std::setw(14) << r.wasted
+        << std::setw(12) << std::fixed << std::setprecision(6) << r.ticks * seconds_per_tick
+        << std::setw(8) << std::setprecision(1) << (total ? 100.0 * r.ticks / total : 0.0) << "%"
+        << std::endl;
+  }
+
+  void header(std::ostream &out, const char *what)
+  {
+    out << "  " << std::left << std::setw(24) << what << std::right
+        << std::setw(8) << "parts"
+        << std::setw(14) << "evaluations"
+        << std::setw(14) << "wasted"
+        << std::setw(12) << "time [s]"
+        << std::setw(9) << "share" << std::endl;
+  }
+
+  bool by_ticks(const row &a, const row &b)
+  {
+    return a.ticks > b.ticks;
+  }
+}
+
+void detail::profiler::report(std::ostream &out, const graph &g, unsigned int top) const
+{
+  std::ios::fmtflags flags = out.flags();
+  std::streamsize precision = out.precision();
+  double seconds_per_tick = run_ticks ? run_seconds / run_ticks : 0;
+
+  std::vector<row> parts;
+  std::map<std::string, row> kinds;
+  uint64_t total = 0;
+  for(unsigned int p = 0; p < g.parts.size() && p < evals.size(); p++)
+    {
+      row r;
+      r.name = g.parts[p]->getname();
+      r.parts = 1;
+      r.evals = evals[p];
+      r.wasted = wasted[p];
+      r.ticks = ticks[p];
+      total += r.ticks;
+
+      row &k = kinds[r.name];
+      k.name = r.name;
+      k.parts++;
+      k.evals += r.evals;
+      k.wasted += r.wasted;
+      k.ticks += r.ticks;
+
+      r.name += "#" + std::to_string(p);
+      parts.push_back(r);
+    }
+
+  out << "Profile: " << steps << " time steps, " << deltas << " delta cycles";
+  if(steps > 0)
+    out << " (" << std::fixed << std::setprecision(2) << static_cast<double>(deltas) / steps
+        << " per step, at most " << max_deltas << " at time " << max_deltas_time << ")";
+  out << ", " << std::fixed << std::setprecision(6) << run_seconds << " s" << std::endl;
+
+  std::vector<row> sorted;
+  for(auto &k : kinds)
+    sorted.push_back(k.second);
+  std::sort(sorted.begin(), sorted.end(), by_ticks);
+  out << "Parts by kind:" << std::endl;
+  header(out, "kind");
+  for(auto &r : sorted)
+    print(out, r, seconds_per_tick, total);
+
+  std::sort(parts.begin(), parts.end(), by_ticks);
+  if(parts.size() > top)
+    parts.resize(top);
+  out << "Top parts:" << std::endl;
+  header(out, "part");
+  for(auto &r : parts)
+    print(out, r, seconds_per_tick, total);
+
+  std::vector<std::pair<uint64_t, unsigned int> > wires;
+  for(unsigned int w = 0; w < g.wires.size() && w < changes.size(); w++)
+    if(changes[w] > 0)
+      wires.push_back(std::make_pair(changes[w], w));
+  std::sort(wires.begin(), wires.end(),
+            [] (const std::pair<uint64_t, unsigned int> &a,
+                const std::pair<uint64_t, unsigned int> &b)
+            {
+              return a.first > b.first || (a.first == b.first && a.second < b.second);
+            });
+  if(wires.size() > top)
+    wires.resize(top);
+  out << "Top wires:" << std::endl;
+  out << "  " << std::left << std::setw(24) << "wire" << std::right
+      << std::setw(14) << "changes" << std::endl;
+  for(auto &w : wires)
+    out << "  " << std::left << std::setw(24) << g.wires[w.second]->getname() + "#" + std::to_string(w.second)
+        << std::right << std::setw(14) << w.first << std::endl;
+
+  out.flags(flags);
+  out.precision(precision);
+}
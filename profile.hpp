@@ -0,0 +1,95 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace hdl
+{
+  namespace detail
+  {
+    class graph;
+
+    // Counters collected by the simulator when built with -DPROFILE.
+    // The evaluation and change counts are exact. Parts of a kind are
+    // timed by batch and share its time evenly, other parts are timed
+    // once every sample evaluations.
+    class profiler
+    {
+    public:
+      static const unsigned int sample = 16;
+
+      // per part
+      std::vector<uint64_t> evals;
+      std::vector<uint64_t> wasted;
+      std::vector<uint64_t> ticks;
+
+      // per wire
+      std::vector<uint64_t> changes;
+
+      uint64_t steps = 0;
+      uint64_t deltas = 0;
+      uint64_t max_deltas = 0;
+      uint64_t max_deltas_time = 0;
+
+      // calibration of ticks
+      uint64_t run_ticks = 0;
+      double run_seconds = 0;
+
+      // Cheap time stamp, the TSC where available.
+      static inline uint64_t now()
+      {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>
+          (std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+      }
+
+      void resize(std::size_t nparts, std::size_t nwires);
+      void step(uint64_t time, uint64_t ndeltas);
+      void share(const unsigned int *parts, std::size_t n, uint64_t t);
+
+      // Parts grouped by kind (their name), the parts with the most
+      // time and the busiest wires.
+      void report(std::ostream &out, const graph &g, unsigned int top = 20) const;
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,93 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+#include <iostream>
+#include <hdlsim.hpp>
+
+using namespace hdl;
+
+// Pins what a reg does when its reset is released in the time step of
+// a rising clock edge. event() only holds in the delta cycle in which
+// the clock changed, like rising_edge() in VHDL:
+//  - a reset released by the testbench together with the edge is gone
+//    in that delta cycle, so the reg takes the edge;
+//  - a reset that passes through gates is released some delta cycles
+//    later, the reg is still in reset at the edge and waits for the
+//    next one. This is what shifts pwm and clkdiv by one period.
+// Exits with 1 if a reg deviates from that.
+
+namespace
+{
+  unsigned int failures = 0;
+
+  void run(bool levelized)
+  {
+    context ctx;
+    context::scope bind(ctx);
+
+    wire<std_logic> clk, reset, one(1), nreset, reset2;
+    wire<std_logic> direct, gated;
+    reg(clk, reset, one, one, direct);
+    invert(reset, nreset);
+    invert(nreset, reset2);
+    reg(clk, reset2, one, one, gated);
+
+    part tb({}, { clk, reset }, [&] (uint64_t t)
+            {
+              clk = t % 2;
+              reset = t >= 5;
+            }, "tb");
+
+    simulator sim(tb);
+    sim.levelize(levelized);
+    for(uint64_t t = 0; t < 10; t++)
+      {
+        sim.run(1);
+        std_logic d = direct;
+        std_logic g = gated;
+        // direct takes the edge at 5, gated the next one at 7, both
+        // are U while in reset
+        std_logic ed = t >= 5 ? std_logic(true) : std_logic();
+        std_logic eg = t >= 7 ? std_logic(true) : std_logic();
+        if(d != ed || g != eg)
+          {
+            std::cout << (levelized ? "levelized" : "event") << " [" << t << "]: direct "
+                      << d << " gated " << g << ", expected " << ed << " " << eg << std::endl;
+            failures++;
+          }
+      }
+  }
+}
+
+int main()
+{
+  run(false);
+  run(true);
+  std::cout << failures << " deviations" << std::endl;
+  return failures ? 1 : 0;
+}
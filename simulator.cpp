@@ -25,94 +25,592 @@
  * POSSIBILITY OF SUCH DAMAGE.
  *****************************************************************************/
 
+#include <cassert>
+#include <chrono>
+#include <limits>
+#include <kind.hpp>
 #include <simulator.hpp>
+#include <tracer.hpp>
 
 using namespace hdl;
 
 simulator::simulator(part testbench)
-  : tb(testbench), cur_time(0)
+  : ctx(context::current()), tb(testbench), cur_time(0)
 {}
 
+thread_local simulator *simulator::running = NULL;
+
+void simulator::levelize(bool on)
+{
+  levelized = on;
+}
+
+void simulator::threads(unsigned int n, std::size_t min_parts, std::size_t grain)
+{
+  parallel_min = min_parts;
+  parallel_grain = std::max<std::size_t>(1, grain);
+  if(n > 1)
+    pool.reset(new detail::thread_pool(n));
+  else
+    pool.reset();
+}
+
+void simulator::trace(tracer &t)
+{
+  tracing = &t;
+  traced_generation = 0;
+}
+
+// look up the probes of the tracer by wire id
+void simulator::bind_tracer()
+{
+  traced.resize(ctx.flat.wires.size());
+  traced.clear();
+  tracing->by_id.clear();
+  for(unsigned int c = 0; c < tracing->probes.size(); c++)
+    for(auto &w : tracing->probes[c]->wires)
+      {
+        traced.set(w->id);
+        tracing->by_id.insert(std::make_pair(w->id, c));
+      }
+  traced_generation = ctx.generation;
+}
+
+void simulator::schedule(uint64_t time)
+{
+  assert(running);
+  detail::base *p = running->tb.p->get_cur_part();
+  assert(p);
+  std::lock_guard<std::mutex> lock(running->ctx.wheel_mutex);
+  // wake-ups have to lie in the future
+  if(time <= running->cur_time)
+    time = running->cur_time + 1;
+  running->ctx.wheel.schedule(time, p);
+  if(p == running->tb.p.get())
+    running->tb_free = false;
+}
+
 void simulator::run(uint64_t duration)
 {
-  std::vector<std::shared_ptr<hdl::detail::base> > wires2up;
-  std::vector<std::shared_ptr<hdl::detail::base> > procs2up;
-  std::shared_ptr<hdl::detail::base> testbench = tb.p;
+  simulator *outer = running;
+  running = this;
+  context::scope bind(ctx);
+  ctx.freeze();
+  if(tracing && traced_generation != ctx.generation)
+    bind_tracer();
+#ifdef PROFILE
+  prof.resize(ctx.flat.parts.size(), ctx.flat.wires.size());
+  auto started = std::chrono::steady_clock::now();
+  uint64_t started_ticks = detail::profiler::now();
+#endif
 
-  for(; duration > 0; duration--, cur_time++)
+  uint64_t end = cur_time + duration;
+  while(cur_time < end)
     {
 #ifdef DEBUG
       std::cerr << "Time: " << cur_time << std::endl;
 #endif
 
-      // Run testbench
-      testbench->update(cur_time);
+      // collect scheduled parts
+      bool run_tb = tb_free;
+      due.clear();
+      if(!ctx.wheel.empty() && ctx.wheel.next() == cur_time)
+        ctx.wheel.pop(cur_time, due);
+      for(unsigned int c = 0; c < due.size(); c++)
+        if(due[c] == tb.p.get())
+          {
+            run_tb = true;
+            due[c] = due.back();
+            due.pop_back();
+            c--;
+          }
+
+      uint64_t deltas = ctx.delta;
+      if(levelized)
+        step_levelized(run_tb);
+      else
+        step_event(run_tb);
+
+      // one for the testbench, one per wire update
+      counts.steps++;
+      counts.deltas += ctx.delta - deltas - 1;
+      counts.evaluations += run_tb;
+#ifdef PROFILE
+      prof.step(cur_time, ctx.delta - deltas - 1);
+#endif
+
+      if(tracing)
+        tracing->step(cur_time);
+
+      // skip time steps without any events
+      if(tb_free)
+        cur_time++;
+      else if(ctx.wheel.empty())
+        cur_time = end;
+      else
+        cur_time = std::max(cur_time + 1, std::min(ctx.wheel.next(), end));
+    }
+
+#ifdef PROFILE
+  prof.run_ticks += detail::profiler::now() - started_ticks;
+  prof.run_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+#endif
+  running = outer;
+}
+
+void simulator::report(std::ostream &out) const
+{
+#ifdef PROFILE
+  prof.report(out, ctx.flat);
+#else
+  out << "Profiling is not available, build with -DPROFILE." << std::endl;
+#endif
+}
+
+snapshot_t simulator::snapshot() const
+{
+  snapshot_t s;
+  s.time = cur_time;
+  s.delta = ctx.delta;
+  s.first = first;
+  s.tb_free = tb_free;
+  s.nwires = ctx.wires.size();
+  s.nparts = ctx.parts.size();
+
+  std::vector<std::pair<uint64_t, detail::base*> > wakeups;
+  ctx.wheel.entries(wakeups);
+  for(auto &w : wakeups)
+    s.wakeups.push_back(std::make_pair(w.first, w.second->id));
+
+  detail::archive a(s, ctx);
+  for(auto &w : ctx.wires)
+    {
+      a.write(ctx.changed_wires.test(w->id));
+      a.write(w->queued());
+      w->save(a);
+    }
+  for(auto &p : ctx.parts)
+    {
+      a.write(p->changed());
+      a.write(p->queued());
+      p->save(a);
+    }
+  return s;
+}
+
+void simulator::restore(const snapshot_t &s)
+{
+  // the design must not have changed
+  assert(s.nwires == ctx.wires.size());
+  assert(s.nparts == ctx.parts.size());
+
+  cur_time = s.time;
+  ctx.delta = s.delta;
+  first = s.first;
+  tb_free = s.tb_free;
+
+  ctx.wheel = detail::event_wheel();
+  for(auto &w : s.wakeups)
+    ctx.wheel.schedule(w.first, ctx.parts[w.second].get());
+
+  detail::archive a(s, ctx);
+  bool b;
+  for(auto &w : ctx.wires)
+    {
+      a.read(b);
+      ctx.changed_wires.assign(w->id, b);
+      a.read(b);
+      w->set_queued(b);
+      w->load(a);
+    }
+  for(auto &p : ctx.parts)
+    {
+      a.read(b);
+      p->set_changed(b);
+      a.read(b);
+      p->set_queued(b);
+      p->load(a);
+    }
+}
+
+simulator simulator::fork(context &target, std::function<part()> elaborate) const
+{
+  snapshot_t s = snapshot();
+  context::scope bind(target);
+  simulator sim(elaborate());
+  sim.levelized = levelized;
+  sim.restore(s);
+  return sim;
+}
+
+void simulator::rank()
+{
+  unsigned int maxdepth = ctx.flat.rank(level);
+  levels.clear();
+  levels.resize(maxdepth+1);
+
+  // edge triggered parts are not put into the level buckets
+  const detail::graph &g = ctx.flat;
+  edged.assign(g.parts.size(), false);
+  for(auto p : g.posedge.fanout)
+    edged[p] = true;
+  for(auto p : g.negedge.fanout)
+    edged[p] = true;
+  ranked = ctx.generation;
+}
+
+// Put a part that has to be updated into the bucket of its level,
+// edge triggered parts run in the next delta cycle regardless.
+void simulator::wake_level(unsigned int p, unsigned int &lo, unsigned int &hi)
+{
+  const detail::graph &g = ctx.flat;
+  if(g.parts[p]->changed())
+    return;
+  g.parts[p]->set_changed(true);
+  if(edged[p])
+    edge2up.push_back(p);
+  else
+    {
+      levels[level[p]].push_back(p);
+      lo = std::min(lo, level[p]);
+      hi = std::max(hi, level[p]);
+    }
+}
 
-      // initialze with wires that have been changed in the testbench
-      if(first)
+// Collect the edge triggered parts of a wire that just changed. All
+// parts on the same clock edge are evaluated together in one batch.
+void simulator::wake_edges(unsigned int w)
+{
+  const detail::graph &g = ctx.flat;
+  if(g.posedge.first(w) != g.posedge.last(w) && g.wires[w]->rose())
+    for(auto p = g.posedge.first(w); p != g.posedge.last(w); p++)
+      if(!g.parts[*p]->changed())
         {
-          for(auto &w : hdl::detail::wires)
-            wires2up.push_back(w);
-          first = false;
+          g.parts[*p]->set_changed(true);
+          edge2up.push_back(*p);
+        }
+  if(g.negedge.first(w) != g.negedge.last(w) && g.wires[w]->fell())
+    for(auto p = g.negedge.first(w); p != g.negedge.last(w); p++)
+      if(!g.parts[*p]->changed())
+        {
+          g.parts[*p]->set_changed(true);
+          edge2up.push_back(*p);
+        }
+}
+
+void simulator::update_part(unsigned int p)
+{
+  const detail::graph &g = ctx.flat;
+#ifdef PROFILE
+  // time only every few evaluations of a part, counted in evaluate()
+  if((prof.evals[p] - 1) % detail::profiler::sample == 0)
+    {
+      uint64_t t0 = detail::profiler::now();
+      g.parts[p]->update(cur_time);
+      prof.ticks[p] += (detail::profiler::now() - t0) * detail::profiler::sample;
+      return;
+    }
+#endif
+  g.parts[p]->update(cur_time);
+}
+
+// evaluate n members of a kind, the profiler splits the time evenly
+void simulator::update_kind(detail::kind_base *k, const unsigned int *members, std::size_t n)
+{
+#ifdef PROFILE
+  uint64_t t0 = detail::profiler::now();
+  k->eval(members, n, cur_time);
+  const std::vector<unsigned int> &m = batched[k->id];
+  prof.share(batched_parts[k->id].data() + (members - m.data()), n, detail::profiler::now() - t0);
+#else
+  k->eval(members, n, cur_time);
+#endif
+}
+
+// cut the members of a kind (or the plain parts) into pool tasks
+void simulator::split(detail::kind_base *k, const std::vector<unsigned int> &ids, std::size_t grain)
+{
+  for(std::size_t n = 0; n < ids.size(); n += grain)
+    chunks.push_back({ k, ids.data() + n, std::min(grain, ids.size() - n) });
+}
+
+// Update the given parts and collect the wires they changed.
+void simulator::evaluate(std::vector<unsigned int> &procs, bool dedup)
+{
+  const detail::graph &g = ctx.flat;
+  counts.evaluations += procs.size();
+
+  // every thread needs enough parts to be worth waking up the pool
+  bool parallel = pool && procs.size() >= parallel_min*pool->size();
+
+  // Parts of one kind run together once the others are done. They all
+  // read the values of the last delta cycle, so the order does not
+  // matter.
+  for(auto p : procs)
+    {
+#ifdef DEBUG
+      std::cerr << "Updating part " << g.parts[p]->getname() << std::endl;
+#endif
+#ifdef PROFILE
+      prof.evals[p]++;
+#endif
+      if(detail::kind_base *k = g.kinds[p])
+        {
+          if(k->id >= batched.size())
+            {
+              batched.resize(k->id + 1);
+#ifdef PROFILE
+              batched_parts.resize(k->id + 1);
+#endif
+            }
+          if(batched[k->id].size() == 0)
+            batches.push_back(k);
+          batched[k->id].push_back(g.members[p]);
+#ifdef PROFILE
+          batched_parts[k->id].push_back(p);
+#endif
         }
+      else if(parallel)
+        plain.push_back(p);
       else
-        for(auto &w : testbench->children)
-          if(w->changed())
+        update_part(p);
+    }
+
+  if(parallel)
+    {
+      // a few chunks per thread, so that idle threads can steal
+      std::size_t grain = std::max(parallel_grain, procs.size() / (4*pool->size()));
+      for(auto k : batches)
+        split(k, batched[k->id], grain);
+      split(NULL, plain, grain);
+      pool->run(chunks.size(), [&] (std::size_t c)
+                {
+                  running = this;
+                  const chunk &ch = chunks[c];
+                  if(ch.kind)
+                    update_kind(ch.kind, ch.ids, ch.n);
+                  else
+                    for(std::size_t n = 0; n < ch.n; n++)
+                      update_part(ch.ids[n]);
+                });
+      chunks.clear();
+      plain.clear();
+    }
+  else
+    for(auto k : batches)
+      update_kind(k, batched[k->id].data(), batched[k->id].size());
+  for(auto k : batches)
+    {
+      batched[k->id].clear();
+#ifdef PROFILE
+      batched_parts[k->id].clear();
+#endif
+    }
+  batches.clear();
+
+  // A wire can be driven by several parts, so only look at the outputs
+  // once all parts are done. Going through them in order keeps the
+  // result independent of the number of threads.
+  for(auto p : procs)
+    {
+#ifdef PROFILE
+      bool useful = false;
+#endif
+      for(auto w = g.drives.first(p); w != g.drives.last(p); w++)
+        if(ctx.changed_wires.test(*w))
+          {
+#ifdef PROFILE
+            useful = true;
+#endif
+            if(!(dedup && g.wires[*w]->queued()))
+              {
+                g.wires[*w]->set_queued(dedup);
+                wires2up.push_back(*w);
+              }
+          }
+#ifdef PROFILE
+      if(!useful)
+        prof.wasted[p]++;
+#endif
+    }
+}
+
+void simulator::step_levelized(bool run_tb)
+{
+  const detail::graph &g = ctx.flat;
+
+  // (re-)rank if the design has been frozen again since
+  if(ranked != ctx.generation)
+    rank();
+
+  unsigned int testbench = tb.p->id;
+  unsigned int lo = levels.size();
+  unsigned int hi = 0;
+
+  // Run testbench
+  ctx.delta++;
+  if(run_tb)
+    g.parts[testbench]->update(cur_time);
+
+  // initialze with wires that have been changed in the testbench
+  if(first)
+    {
+      for(unsigned int w = 0; w < g.wires.size(); w++)
+        if(!g.wires[w]->queued())
+          {
+            g.wires[w]->set_queued(true);
             wires2up.push_back(w);
+          }
+      first = false;
+    }
+  else if(run_tb)
+    for(auto w = g.drives.first(testbench); w != g.drives.last(testbench); w++)
+      if(ctx.changed_wires.test(*w) && !g.wires[*w]->queued())
+        {
+          g.wires[*w]->set_queued(true);
+          wires2up.push_back(*w);
+        }
 
-      // repeat as long as there are wires to be updated.
-      while(wires2up.size() > 0)
+  // parts that asked to be woken up now
+  for(auto p : due)
+    wake_level(p->id, lo, hi);
+
+  // Every delta cycle evaluates the lowest level with parts to update,
+  // the wires they change are updated before the next one. So a part
+  // runs once all parts driving its inputs are done. The parts of a
+  // combinational loop share one level, which is evaluated again as
+  // long as it wakes itself up, like the event loop does. Edge
+  // triggered parts run in the delta cycle of their event.
+  while(wires2up.size() > 0 || edge2up.size() > 0 || lo <= hi)
+    {
+      ctx.delta++;
+      counts.updates += wires2up.size();
+      for(auto w : wires2up)
         {
 #ifdef DEBUG
-          std::cerr << "Wires to update: " << std::endl;
-          for(auto &w : wires2up)
-            std::cerr << "  " << w->getname() << std::endl;
+          std::cerr << "Updating wire " << g.wires[w]->getname() << std::endl;
+#endif
+          g.wires[w]->update(cur_time);
+          g.wires[w]->set_queued(false);
+          if(tracing && traced.test(w))
+            tracing->changed(w);
+#ifdef PROFILE
+          if(g.wires[w]->value_changed())
+            prof.changes[w]++;
 #endif
+          wake_edges(w);
+          for(auto p = g.readers.first(w); p != g.readers.last(w); p++)
+            wake_level(*p, lo, hi);
+        }
+      wires2up.clear();
 
-          // update wires
-          for(unsigned int c = 0; c < wires2up.size(); c++)
-            {
-#ifdef DEBUG
-              std::cerr << "Updating wire " << wires2up[c]->getname() << std::endl;
-#endif
-              wires2up[c]->update(cur_time);
-              for(auto &p : wires2up[c]->children)
-                if(!p->changed())
-                  {
-                    p->set_changed(true);
-                    procs2up.push_back(p);
-                  }
-            }
-          wires2up.clear();
+      // update edge triggered parts
+      evaluate(edge2up, true);
+      edge2up.clear();
+
+      // update the lowest level
+      while(lo <= hi && levels[lo].size() == 0)
+        lo++;
+      if(lo <= hi)
+        {
+          evaluate(levels[lo], true);
+          levels[lo].clear();
+          lo++;
+        }
+      if(lo > hi)
+        {
+          lo = levels.size();
+          hi = 0;
+        }
+    }
+}
 
-          // sort & unique
-          std::sort(procs2up.begin(), procs2up.end());
-          auto lastproc = std::unique(procs2up.begin(), procs2up.end());
-          procs2up.erase(lastproc, procs2up.end());
+void simulator::step_event(bool run_tb)
+{
+  const detail::graph &g = ctx.flat;
+  unsigned int testbench = tb.p->id;
+
+  // Run testbench
+  ctx.delta++;
+  if(run_tb)
+    g.parts[testbench]->update(cur_time);
+
+  // initialze with wires that have been changed in the testbench
+  if(first)
+    {
+      for(unsigned int w = 0; w < g.wires.size(); w++)
+        wires2up.push_back(w);
+      first = false;
+    }
+  else if(run_tb)
+    for(auto w = g.drives.first(testbench); w != g.drives.last(testbench); w++)
+      if(ctx.changed_wires.test(*w))
+        wires2up.push_back(*w);
 
+  // parts that asked to be woken up now
+  for(auto p : due)
+    if(!p->changed())
+      {
+        p->set_changed(true);
+        procs2up.push_back(p->id);
+      }
+
+  // repeat as long as there are wires or parts to be updated.
+  while(wires2up.size() > 0 || procs2up.size() > 0)
+    {
 #ifdef DEBUG
-          std::cerr << "Parts to update: " << std::endl;
-          for(auto &p : procs2up)
-            std::cerr << "  " << p->getname() << std::endl;
+      std::cerr << "Wires to update: " << std::endl;
+      for(auto &w : wires2up)
+        std::cerr << "  " << g.wires[w]->getname() << std::endl;
 #endif
 
-          // update parts
-          for(unsigned int c = 0; c < procs2up.size(); c++)
-            {
+      // update wires
+      ctx.delta++;
+      counts.updates += wires2up.size();
+      for(auto w : wires2up)
+        {
 #ifdef DEBUG
-              std::cerr << "Updating part " << procs2up[c]->getname() << std::endl;
+          std::cerr << "Updating wire " << g.wires[w]->getname() << std::endl;
 #endif
-              procs2up[c]->update(cur_time);
-              for(auto &w : procs2up[c]->children)
-                if(w->changed())
-                  wires2up.push_back(w);
-            }
-          procs2up.clear();
-
-          // sort & unique
-          std::sort(wires2up.begin(), wires2up.end());
-          auto lastwire = std::unique(wires2up.begin(), wires2up.end());
-          wires2up.erase(lastwire, wires2up.end());
+          g.wires[w]->update(cur_time);
+          if(tracing && traced.test(w))
+            tracing->changed(w);
+#ifdef PROFILE
+          if(g.wires[w]->value_changed())
+            prof.changes[w]++;
+#endif
+          wake_edges(w);
+          for(auto p = g.readers.first(w); p != g.readers.last(w); p++)
+            if(!g.parts[*p]->changed())
+              {
+                g.parts[*p]->set_changed(true);
+                procs2up.push_back(*p);
+              }
         }
+      wires2up.clear();
+
+      // sort & unique
+      std::sort(procs2up.begin(), procs2up.end());
+      auto lastproc = std::unique(procs2up.begin(), procs2up.end());
+      procs2up.erase(lastproc, procs2up.end());
+
+#ifdef DEBUG
+      std::cerr << "Parts to update: " << std::endl;
+      for(auto &p : procs2up)
+        std::cerr << "  " << g.parts[p]->getname() << std::endl;
+#endif
+
+      // update edge triggered parts
+      evaluate(edge2up, false);
+      edge2up.clear();
+
+      // update parts
+      evaluate(procs2up, false);
+      procs2up.clear();
+
+      // sort & unique
+      std::sort(wires2up.begin(), wires2up.end());
+      auto lastwire = std::unique(wires2up.begin(), wires2up.end());
+      wires2up.erase(lastwire, wires2up.end());
     }
 }
@@ -28,20 +28,148 @@
 #ifndef SIMULATOR_HPP
 #define SIMULATOR_HPP
 
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <context.hpp>
 #include <part.hpp>
+#include <pool.hpp>
+#include <profile.hpp>
+#include <snapshot.hpp>
+#include <store.hpp>
 
 namespace hdl
 {
+  class tracer;
+
   class simulator
   {
+  public:
+    // cumulative counts of all runs
+    struct statistics
+    {
+      uint64_t steps = 0;
+      uint64_t deltas = 0;
+      uint64_t evaluations = 0;
+      uint64_t updates = 0;
+    };
+
   private:
+    static thread_local simulator *running;
+
+    context &ctx;
     part tb;
     uint64_t cur_time;
     bool first = true;
+    statistics counts;
+
+    // scheduled wake-ups
+    std::vector<detail::base*> due;
+    bool tb_free = true;
+
+    // levelized scheduling
+    bool levelized = false;
+    unsigned int ranked = 0;
+    std::vector<unsigned int> level;
+    std::vector<std::vector<unsigned int> > levels;
+    std::vector<bool> edged;
+
+    // ids of the wires and parts in the frozen graph of ctx
+    std::vector<unsigned int> wires2up;
+    std::vector<unsigned int> procs2up;
+    std::vector<unsigned int> edge2up;
+
+    // due members per kind (by id) and the kinds with any
+    std::vector<std::vector<unsigned int> > batched;
+    std::vector<detail::kind_base*> batches;
+#ifdef PROFILE
+    // and their part ids
+    std::vector<std::vector<unsigned int> > batched_parts;
+#endif
+
+    // parallel evaluation: members of a kind or parts on their own
+    // (kind is NULL), a task of the pool each
+    struct chunk
+    {
+      detail::kind_base *kind;
+      const unsigned int *ids;
+      std::size_t n;
+    };
+    std::unique_ptr<detail::thread_pool> pool;
+    std::size_t parallel_min = 256;
+    std::size_t parallel_grain = 64;
+    std::vector<unsigned int> plain;
+    std::vector<chunk> chunks;
+
+    // waveform output
+    tracer *tracing = NULL;
+    unsigned int traced_generation = 0;
+    detail::bitmap traced;
+
+#ifdef PROFILE
+    detail::profiler prof;
+#endif
+
+    void rank();
+    void bind_tracer();
+    void wake_edges(unsigned int w);
+    void wake_level(unsigned int p, unsigned int &lo, unsigned int &hi);
+    void update_part(unsigned int p);
+    void update_kind(detail::kind_base *k, const unsigned int *members, std::size_t n);
+    void split(detail::kind_base *k, const std::vector<unsigned int> &ids, std::size_t grain);
+    void evaluate(std::vector<unsigned int> &procs, bool dedup);
+    void step_event(bool run_tb);
+    void step_levelized(bool run_tb);
 
   public:
     simulator(part testbench);
+
+    // Evaluate parts level by level in topological order, so that a
+    // part outside of combinational loops runs once its inputs are
+    // final (no glitches) instead of once per delta cycle in which one
+    // of them changes. Level sensitive parts should not rely on event()
+    // of their inputs, it only holds for edge triggered parts.
+    void levelize(bool on = true);
+
+    // Evaluate the parts of a delta cycle on n threads. The changed
+    // wires are merged in part order, so results do not depend on n.
+    // A delta cycle only goes to the pool with at least min_parts parts
+    // per thread, in tasks of at least grain parts. The defaults were
+    // measured on a single core; tune them with bench on the target.
+    void threads(unsigned int n, std::size_t min_parts = 256, std::size_t grain = 64);
+
+    // Record the wires traced by t while running. t has to stay
+    // alive as long as this simulator runs.
+    void trace(tracer &t);
+
     void run(uint64_t duration);
+
+    // Print evaluation counts and times per part and kind, changes
+    // per wire and delta cycles per time step. Only available when
+    // built with -DPROFILE.
+    void report(std::ostream &out = std::cerr) const;
+
+    // Time steps, delta cycles, part evaluations and wire updates
+    // so far. Always collected, unlike the profile.
+    const statistics &stats() const { return counts; }
+
+    // Capture the current state of all wires, pending wake-ups and
+    // the time and go back to it later. The state of parts other than
+    // their wires (e.g. variables captured by a testbench) is not
+    // part of it.
+    snapshot_t snapshot() const;
+    void restore(const snapshot_t &s);
+
+    // Continue from the current state in another context. elaborate
+    // has to build the same design (in the same order) and return
+    // its testbench; it is called with target being current.
+    simulator fork(context &target, std::function<part()> elaborate) const;
+
+    // Wake up the calling part at the given (future) time. Once the
+    // testbench schedules itself, it is no longer run every time step
+    // and the simulator skips over time steps without any events.
+    static void schedule(uint64_t time);
   };
 }
 
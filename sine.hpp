@@ -0,0 +1,146 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+#ifndef SINE_HPP
+#define SINE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fixed.hpp>
+
+// Quarter-wave sine table with linear interpolation, as it is built in
+// hardware: the top two of pbits phase bits select the quadrant, the next
+// abits address the table and the remaining bits interpolate between two
+// entries. Amplitudes are integers in units of 2^-obits, the table
+// saturates at peak like a ROM for an output type that cannot hold 0.5.
+template <unsigned int pbits, unsigned int abits, unsigned int obits, uint64_t peak>
+class sine_table
+{
+private:
+  static_assert(pbits >= abits + 2, "pbits >= abits + 2");
+  static_assert(pbits - abits - 2 < 32, "at most 31 interpolation bits");
+  static_assert(obits <= 48, "obits <= 48");
+
+  static const unsigned int ibits = pbits - abits - 2;
+  static const uint64_t quadrant = static_cast<uint64_t>(1) << (pbits - 2);
+
+  // the first quadrant of 0.5*sin(), rounded to the output resolution
+  std::array<uint64_t, (static_cast<uint64_t>(1) << abits) + 1> table;
+
+  sine_table()
+  {
+    for(unsigned int c = 0; c < table.size(); c++)
+      table[c] = std::min(peak, static_cast<uint64_t>
+                          (std::floor(std::ldexp(0.5l*std::sin(pi/2*c/(table.size()-1)), obits) + 0.5l)));
+  }
+
+  // 0.5*sin(x*pi/2/quadrant) for x in [0, quadrant], the interpolation
+  // never exceeds the larger of two entries
+  uint64_t quarter(uint64_t x) const
+  {
+    uint64_t n = x >> ibits;
+    uint64_t f = x & ((static_cast<uint64_t>(1) << ibits) - 1);
+    if(f == 0)
+      return table[n];
+    uint64_t slope = table[n+1] - table[n];
+    return table[n] + ((slope*f + ((static_cast<uint64_t>(1) << ibits) >> 1)) >> ibits);
+  }
+
+public:
+  // sine and cosine of phase/2^pbits turns, the table is built on first use
+  static void eval(uint64_t phase, int64_t &s, int64_t &c)
+  {
+    static const sine_table t;
+    uint64_t x = phase & (quadrant - 1);
+    int64_t a = t.quarter(x);
+    int64_t b = t.quarter(quadrant - x);
+    switch((phase >> (pbits - 2)) & 3)
+      {
+      case 0: s = a; c = b; break;
+      case 1: s = b; c = -a; break;
+      case 2: s = -a; c = -b; break;
+      default: s = -b; c = a; break;
+      }
+  }
+};
+
+// sine and cosine of a phase in turns with an amplitude of 0.5, the table
+// resolution follows from the output and phase widths. With the table
+// limited to 2^12 entries, outputs are accurate to about 26 fractional bits.
+template <bool sign, unsigned int pmbits, unsigned int pfbits,
+          unsigned int mbits, unsigned int fbits>
+void sine_cosine(const fixed_t<sign, pmbits, pfbits> &phase,
+                 fixed_t<true, mbits, fbits> &s,
+                 fixed_t<true, mbits, fbits> &c)
+{
+  typedef fixed_t<sign, pmbits, pfbits> phase_t;
+  typedef fixed_t<true, mbits, fbits> out_t;
+
+  const unsigned int obits = fbits < 48 ? fbits : 48;
+  const unsigned int p = pfbits > 2 ? pfbits : 2;
+  const unsigned int a = obits/2 + 2 < 12 ? obits/2 + 2 : 12;
+  const unsigned int abits = a < p - 2 ? a : p - 2;
+  // phase bits below 16 interpolation bits are dropped
+  const unsigned int pbits = p < abits + 18 ? p : abits + 18;
+  // with less than two integer bits the largest value is just below 0.5
+  const uint64_t peak = mbits < 2 ?
+    ((static_cast<uint64_t>(1) << obits) >> 1) - (obits > 0 ? 1 : 0) :
+    static_cast<uint64_t>(1) << obits;
+
+  // the upper pbits bits of the fraction, which ends below the weight 1
+  const int from = -phase_t::lsb - static_cast<int>(pbits);
+  const unsigned int ws = phase_t::word_size;
+  uint64_t n;
+  if(from < 0)
+    n = phase.value[0] << -from;
+  else
+    {
+      n = phase.value[from/ws] >> (from%ws);
+      if(from%ws != 0 && from/ws + 1 < static_cast<int>(phase_t::words))
+        n |= phase.value[from/ws + 1] << (ws - from%ws);
+    }
+  n &= (static_cast<uint64_t>(1) << pbits) - 1;
+
+  int64_t v[2];
+  sine_table<pbits, abits, obits, peak>::eval(n, v[0], v[1]);
+
+  // place the amplitudes, in units of 2^-obits
+  out_t *out[2] = { &s, &c };
+  for(unsigned int i = 0; i < 2; i++)
+    {
+      out_t &o = *out[i];
+      o.value.fill(0);
+      o.place(static_cast<uint64_t>(v[i] < 0 ? -v[i] : v[i]), -static_cast<int>(obits) - out_t::lsb);
+      o.signext();
+      if(v[i] < 0)
+        o = -o;
+    }
+}
+
+#endif
@@ -0,0 +1,92 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+#include <cmath>
+#include <iostream>
+
+#define SYMMETRIC
+#include <hdlsim.hpp>
+
+// Sweeps every phase of small phase types through sine_cosine() and
+// compares against 0.5*sin() from libm, clipped to what the output type
+// can hold. Exits with 1 if any value is off by more than one step.
+
+namespace
+{
+  unsigned int failures = 0;
+
+  template <bool psign, unsigned int pmbits, unsigned int pfbits,
+            unsigned int mbits, unsigned int fbits>
+  void sweep()
+  {
+    // smallest step that survives the conversion to long double
+    const long double step = std::ldexp(1.l, -static_cast<int>(fbits) + (mbits > 0 ? 0 : 1));
+    const long double peak = mbits < 2 ? 0.5l - step : 0.5l;
+    // signed phases range over (-2^(pmbits-2), 2^(pmbits-2))
+    const long long first = psign ? 1 - (1ll << (pmbits + pfbits - 2)) : 0;
+    const long long last = psign ? 1ll << (pmbits + pfbits - 2) : 1ll << pfbits;
+
+    unsigned int bad = 0;
+    long double worst = 0;
+    for(long long k = first; k < last; k++)
+      {
+        fixed_t<psign, pmbits, pfbits> phase(std::ldexp(static_cast<long double>(k), -static_cast<int>(pfbits)));
+        fixed_t<true, mbits, fbits> s, c;
+        sine_cosine(phase, s, c);
+
+        long double p = static_cast<long double>(phase);
+        long double rs = std::max(-peak, std::min(peak, 0.5l*std::sin(2*pi*p)));
+        long double rc = std::max(-peak, std::min(peak, 0.5l*std::cos(2*pi*p)));
+        long double e = std::max(std::fabs(static_cast<long double>(s) - rs),
+                                 std::fabs(static_cast<long double>(c) - rc));
+        worst = std::max(worst, e/step);
+        if(e > step*(1 + 1e-9l))
+          {
+            if(bad++ < 4)
+              std::cout << "  phase " << p << ": sin " << s << " cos " << c
+                        << ", expected " << rs << " " << rc << std::endl;
+          }
+      }
+
+    std::cout << "phase <" << psign << "," << pmbits << "," << pfbits << "> -> <1,"
+              << mbits << "," << fbits << ">: " << (last - first) << " phases, "
+              << bad << " off, worst " << worst << " steps" << std::endl;
+    failures += bad;
+  }
+}
+
+int main()
+{
+  sweep<false, 0, 16, 0, 16>(); // nco, computed in the type of sin(phase)
+  sweep<false, 0, 12, 0, 12>();
+  sweep<false, 0, 12, 1, 12>();
+  sweep<false, 0, 14, 2, 14>();
+  sweep<false, 0, 10, 4, 8>();
+  sweep<true, 2, 12, 4, 8>();
+  return failures ? 1 : 0;
+}
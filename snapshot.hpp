@@ -0,0 +1,144 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <base.hpp>
+
+namespace hdl
+{
+  class context;
+  class simulator;
+
+  // Complete state of a simulation at one point in time. Values of
+  // trivially copyable types are packed into one binary blob, all
+  // others are kept as copies.
+  class snapshot_t
+  {
+  private:
+    uint64_t time = 0;
+    uint64_t delta = 0;
+    bool first = true;
+    bool tb_free = true;
+    std::size_t nwires = 0;
+    std::size_t nparts = 0;
+    std::vector<std::pair<uint64_t, unsigned int> > wakeups;
+    std::vector<char> data;
+    std::vector<std::shared_ptr<void> > objects;
+
+    friend class simulator;
+    friend class detail::archive;
+
+  public:
+    uint64_t get_time() const { return time; }
+    std::size_t size() const { return data.size(); }
+  };
+
+  namespace detail
+  {
+    // Writes node state into a snapshot or reads it back.
+    class archive
+    {
+    private:
+      snapshot_t *out;
+      const snapshot_t *in;
+      context &ctx;
+      std::size_t pos = 0;
+      std::size_t obj = 0;
+
+      template <typename T>
+      typename std::enable_if<std::is_trivially_copyable<T>::value>::type
+      put(const T &t)
+      {
+        std::size_t old = out->data.size();
+        out->data.resize(old + sizeof(T));
+        std::memcpy(&out->data[old], &t, sizeof(T));
+      }
+
+      template <typename T>
+      typename std::enable_if<!std::is_trivially_copyable<T>::value>::type
+      put(const T &t)
+      {
+        out->objects.push_back(std::make_shared<T>(t));
+      }
+
+      template <typename T>
+      typename std::enable_if<std::is_trivially_copyable<T>::value>::type
+      get(T &t)
+      {
+        std::memcpy(&t, &in->data[pos], sizeof(T));
+        pos += sizeof(T);
+      }
+
+      template <typename T>
+      typename std::enable_if<!std::is_trivially_copyable<T>::value>::type
+      get(T &t)
+      {
+        t = *static_cast<const T*>(in->objects[obj++].get());
+      }
+
+    public:
+      // for writing
+      archive(snapshot_t &snap, context &ctx)
+        : out(&snap), in(NULL), ctx(ctx)
+      {
+      }
+
+      // for reading
+      archive(const snapshot_t &snap, context &ctx)
+        : out(NULL), in(&snap), ctx(ctx)
+      {
+      }
+
+      template <typename T>
+      void write(const T &t)
+      {
+        put(t);
+      }
+
+      template <typename T>
+      void read(T &t)
+      {
+        get(t);
+      }
+
+      // parts are stored by their index in the context
+      void write_part(base *p);
+      base *read_part();
+    };
+  }
+}
+
+#endif
@@ -92,11 +92,7 @@ public:
     return result;
   }
 
-  std_logic& operator=(const std_logic& rhs)
-  {
-    state = rhs.state;
-    return *this;
-  }
+  std_logic& operator=(const std_logic& rhs) = default;
 
   std_logic& operator=(const bool rhs)
   {
@@ -240,17 +236,17 @@ public:
   }
 };
 
-std::ostream& operator<<(std::ostream& os, const std_logic& rhs)
+inline std::ostream& operator<<(std::ostream& os, const std_logic& rhs)
 {
   os << (char)rhs;
   return os;
 }
 
 #ifdef MULTIASSIGN
-std_logic resolve(const std::map<hdl::detail::base*, std_logic> &candidates,
-                  const hdl::detail::base *w)
+inline std_logic resolve(const std::map<hdl::detail::base*, std_logic> &candidates,
+                         const hdl::detail::base *w)
 {
-  std_logic result = 'Z';
+  std_logic result = std_logic().z();
   unsigned int nonzcnt = 0;
   for(auto &i : candidates)
     if((char)i.second != 'Z')
@@ -271,7 +267,7 @@ std_logic resolve(const std::map<hdl::detail::base*, std_logic> &candidates,
                 std::cerr << "(" << i.second << ") ";
               }
             std::cerr << std::endl;
-            result = 'U';
+            result = std_logic();
             break;
           }
       }
@@ -29,11 +29,17 @@
 #define STDLIB_HPP
 
 #include <array>
+#include <mutex>
+#include <sstream>
 #include <type_traits>
 
 #include <wire.hpp>
 #include <part.hpp>
 #include <fixed.hpp>
+#include <kernels.hpp>
+#include <kind.hpp>
+#include <lanes.hpp>
+#include <logic_vector.hpp>
 
 namespace hdl
 {
@@ -44,6 +50,17 @@ namespace hdl
 
   //---------------------------------------------------------------------------
 
+  namespace detail
+  {
+    // print parts may run on several threads
+    inline void print_line(const std::string &line)
+    {
+      static std::mutex mutex;
+      std::lock_guard<std::mutex> lock(mutex);
+      std::cout << line << std::endl;
+    }
+  }
+
   template <typename T>
   void print(wire<T> w)
   {
@@ -51,8 +68,10 @@ namespace hdl
          { },
          [=] (uint64_t time)
          {
-           std::cout << "[" << time << "] "
-                     << w.getname() << ": " << w << std::endl;
+           std::stringstream ss;
+           ss << "[" << time << "] "
+              << w.getname() << ": " << w;
+           detail::print_line(ss.str());
          }, "print");
   }
   
@@ -63,8 +82,10 @@ namespace hdl
          { },
          [=] (uint64_t time)
          {
-           std::cout << "[" << time << "] "
-                     << b.getname() << ": " << b << std::endl;
+           std::stringstream ss;
+           ss << "[" << time << "] "
+              << b.getname() << ": " << b;
+           detail::print_line(ss.str());
          }, "print");
   }
 
@@ -75,8 +96,10 @@ namespace hdl
          { },
          [=] (uint64_t time)
          {
-           std::cout << "[" << time << "] "
-                     << b.getname() << ": " << static_cast<U>(b) << std::endl;
+           std::stringstream ss;
+           ss << "[" << time << "] "
+              << b.getname() << ": " << static_cast<U>(b);
+           detail::print_line(ss.str());
          }, "print");
   }
 
@@ -84,12 +107,9 @@ namespace hdl
   void assign(wire<T> in,
               wire<T> out)
   {
-    part({ in },
-         { out },
-         [=] (uint64_t)
-         {
-           out = in;
-         }, "assign");
+    make_part(std::make_tuple(in),
+              std::make_tuple(out),
+              kernel::assign(), "assign");
   }
 
   template <typename T, unsigned int bits>
@@ -110,12 +130,9 @@ namespace hdl
   assign(wire<fixed_t<sign1, mbits, fbits>> in,
               wire<fixed_t<sign2, mbits, fbits>> out)
   {
-    part({ in },
-         { out },
-         [=] (uint64_t)
-         {
-           out = in;
-         }, "assign");
+    make_part(std::make_tuple(in),
+              std::make_tuple(out),
+              kernel::assign(), "assign");
   }
 
   template<typename T, bool sign, unsigned int bits,
@@ -150,6 +167,64 @@ namespace hdl
          }, "assign");
   }
 
+  // pack a bus into a single wire and back
+
+  template <typename T, unsigned int bits>
+  void assign(bus<T, bits> in,
+              wire<logic_vector<bits>> out)
+  {
+    part({ in },
+         { out },
+         [=] (uint64_t)
+         {
+           logic_vector<bits> tmp;
+           for(unsigned int c = 0; c < bits; c++)
+             tmp.set(c, static_cast<T>(in[c]));
+           out = tmp;
+         }, "assign");
+  }
+
+  template <typename T, unsigned int bits>
+  void assign(wire<logic_vector<bits>> in,
+              bus<T, bits> out)
+  {
+    part({ in },
+         { out },
+         [=] (uint64_t)
+         {
+           logic_vector<bits> tmp = in;
+           for(unsigned int c = 0; c < bits; c++)
+             out[c] = static_cast<T>(tmp[c]);
+         }, "assign");
+  }
+
+  // bits hi downto lo of a packed bus
+  template <unsigned int hi, unsigned int lo, unsigned int bits>
+  void slice(wire<logic_vector<bits>> in,
+             wire<logic_vector<hi-lo+1>> out)
+  {
+    part({ in },
+         { out },
+         [=] (uint64_t)
+         {
+           out = in.get().template slice<hi, lo>();
+         }, "slice");
+  }
+
+  // drive only bits hi downto lo of a packed bus, the other bits are
+  // left to other parts
+  template <unsigned int hi, unsigned int lo, unsigned int bits>
+  void assign_slice(wire<logic_vector<hi-lo+1>> in,
+                    wire<logic_vector<bits>> out)
+  {
+    part({ in },
+         { out },
+         [=] (uint64_t)
+         {
+           out = logic_vector<bits>::template only<hi, lo>(in);
+         }, "assign_slice");
+  }
+
   template <typename B, typename T>
   void reg(wire<B> clk,
            wire<B> reset,
@@ -157,16 +232,11 @@ namespace hdl
            wire<T> din,
            wire<T> dout)
   {
-    part({ clk, reset, enable, din },
-         { dout },
-         [=] (uint64_t)
-         {
-           if(reset == static_cast<B>(false))
-             dout = T();
-           else if(clk.event() and clk == static_cast<B>(true)
-                   and enable == static_cast<B>(true))
-             dout = din;
-         }, "reg");
+    make_part({ posedge(clk) },
+              { reset },
+              std::make_tuple(clk, reset, enable, din),
+              std::make_tuple(dout),
+              kernel::reg(), "reg");
   }
 
   template <typename B, typename T, unsigned int bits>
@@ -199,12 +269,9 @@ namespace hdl
   void invert(wire<T> in,
               wire<T> out)
   {
-    part({ in },
-         { out },
-         [=] (uint64_t)
-         {
-           out = ~in;
-         }, "invert");
+    make_part(std::make_tuple(in),
+              std::make_tuple(out),
+              kernel::invert(), "invert");
   }
   
   template <typename T>
@@ -212,12 +279,9 @@ namespace hdl
             wire<T> in2,
             wire<T> out)
   {
-    part({ in1, in2 },
-         { out },
-         [=] (uint64_t)
-         {
-           out = in1 & in2;
-         }, "and1");
+    make_part(std::make_tuple(in1, in2),
+              std::make_tuple(out),
+              kernel::band(), "and1");
   }
 
   template <typename T>
@@ -235,12 +299,9 @@ namespace hdl
            wire<T> in2,
            wire<T> out)
   {
-    part({ in1, in2 },
-         { out },
-         [=] (uint64_t)
-         {
-           out = in1 | in2;
-         }, "or1");
+    make_part(std::make_tuple(in1, in2),
+              std::make_tuple(out),
+              kernel::bor(), "or1");
   }
 
   template <typename T>
@@ -258,12 +319,9 @@ namespace hdl
             wire<T> in2,
             wire<T> out)
   {
-    part({ in1, in2 },
-         { out },
-         [=] (uint64_t)
-         {
-           out = in1 ^ in2;
-         }, "xor1");
+    make_part(std::make_tuple(in1, in2),
+              std::make_tuple(out),
+              kernel::bxor(), "xor1");
   }
 
   template <typename T>
@@ -285,41 +343,53 @@ namespace hdl
            wire<T> carryout = wire<T>())
   {
     static_assert(mbits + fbits > 0, "mbits + fbits > 0");
-    part({ in1, in2, carryin },
-         { out, carryout },
-         [=] (uint64_t)
-         {
-           bool carry = carryin;
-           out = in1.get().sum(in2.get(), carry);
-           carryout = carry;
-         }, "add");
+    make_part(std::make_tuple(in1, in2, carryin),
+              std::make_tuple(out, carryout),
+              kernel::add(), "add");
+  }
+
+  // Lanes of fixed_t hold one value per lane, so unlike the bit planes
+  // of std_logic the sum is computed lane by lane.
+  template <unsigned int N, bool sign, bool sign2, bool sign3,
+            unsigned int mbits, unsigned int fbits>
+  void add(wire<lanes<fixed_t<sign, mbits, fbits>, N>> in1,
+           wire<lanes<fixed_t<sign2, mbits, fbits>, N>> in2,
+           wire<lanes<fixed_t<sign3, mbits, fbits>, N>> out,
+           wire<lanes<bool, N>> carryin = wire<lanes<bool, N>>(false),
+           wire<lanes<bool, N>> carryout = wire<lanes<bool, N>>())
+  {
+    static_assert(mbits + fbits > 0, "mbits + fbits > 0");
+    make_part(std::make_tuple(in1, in2, carryin),
+              std::make_tuple(out, carryout),
+              kernel::lane_add(), "add");
+  }
+
+  template <unsigned int bits>
+  void add(wire<logic_vector<bits>> in1,
+           wire<logic_vector<bits>> in2,
+           wire<logic_vector<bits>> out)
+  {
+    make_part(std::make_tuple(in1, in2),
+              std::make_tuple(out),
+              kernel::plus(), "add");
   }
 
   template <unsigned int mbits, unsigned int fbits>
   void negative(wire<fixed_t<true, mbits, fbits>> in,
                 wire<fixed_t<true, mbits, fbits>> out)
   {
-    part({ in },
-         { out },
-         [=] (uint64_t)
-         {
-           out = -in;
-         }, "negative");
+    make_part(std::make_tuple(in),
+              std::make_tuple(out),
+              kernel::negative(), "negative");
   }
 
   template <unsigned int mbits, unsigned int fbits>
   void absolute(wire<fixed_t<true, mbits, fbits>> in,
                 wire<fixed_t<true, mbits, fbits>> out)
   {
-    part({ in },
-         { out },
-         [=] (uint64_t)
-         {
-           if(in < 0)
-             out = -in;
-           else
-             out = in;
-         }, "negative");
+    make_part(std::make_tuple(in),
+              std::make_tuple(out),
+              kernel::absolute(), "negative");
   }
 
   template <typename T = bool, bool sign, bool sign2, bool sign3,
@@ -331,14 +401,19 @@ namespace hdl
            wire<T> borrowout = wire<T>())
   {
     static_assert(mbits + fbits > 0, "mbits + fbits > 0");
-    part({ in1, in2, borrowin },
-         { out, borrowout },
-         [=] (uint64_t)
-         {
-           T borrow = borrowin;
-           out = in1.get().diff(in2.get(), borrow);
-           borrowout = borrow;
-         }, "sub");
+    make_part(std::make_tuple(in1, in2, borrowin),
+              std::make_tuple(out, borrowout),
+              kernel::sub(), "sub");
+  }
+
+  template <unsigned int bits>
+  void sub(wire<logic_vector<bits>> in1,
+           wire<logic_vector<bits>> in2,
+           wire<logic_vector<bits>> out)
+  {
+    make_part(std::make_tuple(in1, in2),
+              std::make_tuple(out),
+              kernel::minus(), "sub");
   }
 
   template <typename B, bool sign, unsigned int mbits, unsigned int fbits>
@@ -351,29 +426,18 @@ namespace hdl
                wire<B> smallerequal = wire<B>(),
                wire<B> greaterequal = wire<B>())
   {
-    part({ in1, in2 },
-         { equal, smaller, greater, unequal, smallerequal, greaterequal },
-         [=] (uint64_t)
-         {
-           equal = in1 == in2;
-           smaller = in1 < in2;
-           greater = in2 > in2;
-           unequal = in1 != in2;
-           smallerequal = in1 <= in2;
-           greaterequal = in1 >= in2;
-         }, "compare");
+    make_part(std::make_tuple(in1, in2),
+              std::make_tuple(equal, smaller, greater, unequal, smallerequal, greaterequal),
+              kernel::compare(), "compare");
   }
 
   template <bool sign, unsigned int mbits1, unsigned int mbits2, unsigned int fbits1, unsigned int fbits2>
   void resize(wire<fixed_t<sign, mbits1, fbits1>> in,
               wire<fixed_t<sign, mbits2, fbits2>> out)
   {
-    part({ in },
-         { out },
-         [=] (uint64_t)
-         {
-           out = in.get().template resize<mbits2, fbits2>();
-         }, "resize");
+    make_part(std::make_tuple(in),
+              std::make_tuple(out),
+              kernel::resize(), "resize");
   }
 
   template <bool sign, unsigned int mbits1, unsigned int mbits2, unsigned int fbits1, unsigned int fbits2>
@@ -389,12 +453,9 @@ namespace hdl
                           int amount,
                           wire<fixed_t<sign, mbits, fbits>> output)
   {
-    part({ input },
-         { output },
-         [=] (uint64_t)
-         {
-           output = input << amount;
-         }, "barrel_shift_fixed");
+    make_part(std::make_tuple(input),
+              std::make_tuple(output),
+              kernel::shift_by(amount), "barrel_shift_fixed");
   }
 
   template <bool sign, unsigned int mbits, unsigned int fbits, bool sign2>
@@ -402,12 +463,9 @@ namespace hdl
                     wire<fixed_t<sign2, log2ceil(mbits+fbits)+1, 0>> amount,
                     wire<fixed_t<sign, mbits, fbits>> output)
   {
-    part({ input, amount },
-         { output },
-         [=] (uint64_t)
-         {
-           output = input << amount;
-         }, "barrel_shift");
+    make_part(std::make_tuple(input, amount),
+              std::make_tuple(output),
+              kernel::shift(), "barrel_shift");
   }
 
   template <bool sign, unsigned int mbits, unsigned int fbits,
@@ -416,12 +474,48 @@ namespace hdl
            wire<fixed_t<sign, mbits2, fbits2>> in2,
            wire<fixed_t<sign, mbits+mbits2, fbits+fbits2>> out)
   {
-    part({ in1, in2 },
-         { out },
-         [=] (uint64_t)
-         {
-           out = in1 * in2;
-         }, "mul");
+    make_part(std::make_tuple(in1, in2),
+              std::make_tuple(out),
+              kernel::mul(), "mul");
+  }
+
+  // lower bits of the product
+  template <unsigned int bits>
+  void mul(wire<logic_vector<bits>> in1,
+           wire<logic_vector<bits>> in2,
+           wire<logic_vector<bits>> out)
+  {
+    make_part(std::make_tuple(in1, in2),
+              std::make_tuple(out),
+              kernel::mul(), "mul");
+  }
+
+  // truncated quotient, saturates on overflow and division by zero
+  template <bool sign, unsigned int mbits, unsigned int fbits,
+            unsigned int mbits2, unsigned int fbits2>
+  void div(wire<fixed_t<sign, mbits, fbits>> in1,
+           wire<fixed_t<sign, mbits2, fbits2>> in2,
+           wire<fixed_t<sign, mbits+mbits2, fbits+fbits2>> out)
+  {
+    make_part(std::make_tuple(in1, in2),
+              std::make_tuple(out),
+              kernel::div(), "div");
+  }
+
+  // pipelined divider, the quotient appears stages clock cycles later
+  template <unsigned int stages, typename B, bool sign,
+            unsigned int mbits, unsigned int fbits,
+            unsigned int mbits2, unsigned int fbits2>
+  void div(wire<B> clk,
+           wire<B> reset,
+           wire<B> enable,
+           wire<fixed_t<sign, mbits, fbits>> in1,
+           wire<fixed_t<sign, mbits2, fbits2>> in2,
+           wire<fixed_t<sign, mbits+mbits2, fbits+fbits2>> out)
+  {
+    wire<fixed_t<sign, mbits+mbits2, fbits+fbits2>> quotient;
+    div(in1, in2, quotient);
+    delay<stages>(clk, reset, enable, quotient, out);
   }
 
   template <typename B, bool sign, unsigned int mbits, unsigned int fbits>
@@ -508,19 +602,16 @@ namespace hdl
       }
   }
 
+  // amplitude 0.5, from a quarter-wave table (see sine.hpp)
   template<bool sign, unsigned int phase_mbits, unsigned int phase_fbits,
            unsigned int mbits, unsigned int fbits>
   void sincos(wire<fixed_t<sign, phase_mbits, phase_fbits>> phase,
               wire<fixed_t<true, mbits, fbits>> sin_out,
               wire<fixed_t<true, mbits, fbits>> cos_out)
   {
-    part({ phase },
-         { sin_out, cos_out },
-         [=] (uint64_t)
-         {
-           sin_out = sin(phase.get()).template resize<mbits, fbits>();
-           cos_out = cos(phase.get()).template resize<mbits, fbits>();
-         }, "sincos");
+    make_part(std::make_tuple(phase),
+              std::make_tuple(sin_out, cos_out),
+              kernel::sincos(), "sincos");
   }
 
   template<typename B, unsigned int freq_bits,
@@ -0,0 +1,163 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+
+#ifndef STORE_HPP
+#define STORE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace hdl
+{
+  namespace detail
+  {
+    class base;
+
+    // Flags indexed by id that can be set and reset concurrently.
+    // Growing is only allowed while no one else is accessing it.
+    class bitmap
+    {
+    private:
+      std::unique_ptr<std::atomic<uint64_t>[]> words;
+      std::size_t nwords = 0;
+
+    public:
+      void resize(std::size_t n);
+      void clear();
+
+      inline void set(std::size_t n)
+      {
+        words[n/64].fetch_or(uint64_t(1) << (n%64), std::memory_order_relaxed);
+      }
+
+      inline void reset(std::size_t n)
+      {
+        words[n/64].fetch_and(~(uint64_t(1) << (n%64)), std::memory_order_relaxed);
+      }
+
+      inline void assign(std::size_t n, bool b)
+      {
+        if(b)
+          set(n);
+        else
+          reset(n);
+      }
+
+      inline bool test(std::size_t n) const
+      {
+        return (words[n/64].load(std::memory_order_relaxed) >> (n%64)) & 1;
+      }
+    };
+
+    class store_base
+    {
+    public:
+      virtual ~store_base() {}
+      virtual void clear_drivers() {}
+    };
+
+    // The values of all wires of one type in a context, one slot per
+    // wire. The change flags are shared by all stores of the context
+    // and indexed by wire id. Every delta cycle has a unique stamp and
+    // changed_at holds the one of the last update that changed a value.
+    template <typename T>
+    class value_store : public store_base
+    {
+    private:
+      // no std::vector<bool>, parts set wires concurrently
+      typedef typename std::conditional<std::is_same<T, bool>::value, char, T>::type elem_t;
+
+      std::array<std::mutex, 64> locks;
+
+    public:
+      bitmap &changed;
+      const uint64_t &delta;
+
+      std::vector<elem_t> state;
+      std::vector<elem_t> prev_state;
+      std::vector<uint64_t> changed_at;
+#ifdef MULTIASSIGN
+      // one slot per (wire, declared driver)
+      std::vector<base*> driver_part;
+      std::vector<elem_t> driver_value;
+      std::vector<char> driver_set;
+#else
+      std::vector<elem_t> next_state;
+      bitmap been_set;
+#endif
+
+      value_store(bitmap &changed, const uint64_t &delta)
+        : changed(changed), delta(delta)
+      {
+      }
+
+      unsigned int add()
+      {
+        state.push_back(T());
+        prev_state.push_back(T());
+        changed_at.push_back(0);
+#ifndef MULTIASSIGN
+        next_state.push_back(T());
+        been_set.resize(state.size());
+#endif
+        return state.size() - 1;
+      }
+
+#ifdef MULTIASSIGN
+      unsigned int add_drivers(unsigned int n, const T &initial)
+      {
+        unsigned int first = driver_part.size();
+        driver_part.resize(first + n, NULL);
+        driver_value.resize(first + n, initial);
+        driver_set.resize(first + n, false);
+        return first;
+      }
+
+      virtual void clear_drivers()
+      {
+        driver_part.clear();
+        driver_value.clear();
+        driver_set.clear();
+      }
+#endif
+
+      std::mutex &lock(unsigned int slot)
+      {
+        return locks[slot % locks.size()];
+      }
+    };
+  }
+}
+
+#endif
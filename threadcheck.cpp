@@ -0,0 +1,160 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <hdlsim.hpp>
+
+using namespace hdl;
+
+// Runs the same design on one thread and on several ones and compares
+// the values of all wires after every time step. The design mixes gates
+// (batched kinds), registers (edge parts), plain parts and a wire with
+// two drivers. One of the runs forces every delta cycle onto the pool,
+// in tasks of a single part, so that the parallel path is taken even
+// for small designs and on a single core.
+// Exits with 1 if a run deviates from the one on one thread.
+
+namespace
+{
+  typedef wire<std_logic> logic;
+
+  const unsigned int bits = 96;
+  const uint64_t ticks = 200;
+
+  std::vector<std::string> run(bool levelized, unsigned int threads,
+                               std::size_t min_parts, std::size_t grain)
+  {
+    context ctx;
+    context::scope bind(ctx);
+
+    logic clk, reset, one(1);
+    std::vector<logic> a(bits), b(bits), s(bits), q(bits), carry(bits+1);
+    std::vector<logic> all;
+    carry[0] = 0;
+    for(unsigned int c = 0; c < bits; c++)
+      {
+        logic x, g, p;
+        bxor(a[c], b[c], x);
+        bxor(x, carry[c], s[c]);
+        band(a[c], b[c], g);
+        band(x, carry[c], p);
+        bor(g, p, carry[c+1]);
+        reg(clk, reset, one, s[c], q[c]);
+        all.insert(all.end(), { x, g, p, s[c], q[c], carry[c+1] });
+      }
+
+    // plain parts, and a bus driven by both of them in turns
+    logic shared, parity;
+    part({ q[0], q[1] }, { shared }, [=] (uint64_t)
+         {
+           std_logic v = q[0];
+           shared = v == std_logic(true) ? v : std_logic().z();
+         }, "even");
+    part({ q[0], q[1] }, { shared }, [=] (uint64_t)
+         {
+           std_logic v = q[0];
+           shared = v == std_logic(true) ? std_logic().z() : std_logic(q[1]);
+         }, "odd");
+    std::list<std::shared_ptr<detail::base> > sums;
+    for(auto &w : s)
+      sums.push_back(w);
+    part({ sums }, { parity }, [=] (uint64_t)
+         {
+           bool p = false;
+           for(auto w : s)
+             p = p != (std_logic(w) == std_logic(true));
+           parity = p;
+         }, "parity");
+    all.push_back(shared);
+    all.push_back(parity);
+
+    std::list<std::shared_ptr<detail::base> > driven = { clk, reset };
+    for(unsigned int c = 0; c < bits; c++)
+      {
+        driven.push_back(a[c]);
+        driven.push_back(b[c]);
+      }
+    std::shared_ptr<std::mt19937> rng(new std::mt19937(1));
+    part tb({}, { driven }, [=] (uint64_t t)
+            {
+              clk = t % 2;
+              reset = t >= 4;
+              if(t % 2 == 0)
+                for(unsigned int c = 0; c < bits; c++)
+                  {
+                    unsigned int r = (*rng)();
+                    a[c] = static_cast<bool>(r & 1);
+                    b[c] = static_cast<bool>(r & 2);
+                  }
+            }, "tb");
+
+    simulator sim(tb);
+    sim.levelize(levelized);
+    sim.threads(threads, min_parts, grain);
+    std::vector<std::string> trace;
+    for(uint64_t t = 0; t < ticks; t++)
+      {
+        sim.run(1);
+        std::stringstream ss;
+        for(auto &w : all)
+          ss << std_logic(w);
+        trace.push_back(ss.str());
+      }
+    return trace;
+  }
+}
+
+int main()
+{
+  unsigned int failures = 0;
+  for(bool levelized : { false, true })
+    {
+      std::vector<std::string> serial = run(levelized, 1, 256, 64);
+      struct { unsigned int threads; std::size_t min_parts, grain; } runs[] =
+        { { 4, 256, 64 }, { 4, 0, 1 }, { 3, 0, 7 }, { 2, 1, 1 } };
+      for(auto &r : runs)
+        {
+          std::vector<std::string> parallel = run(levelized, r.threads, r.min_parts, r.grain);
+          for(uint64_t t = 0; t < ticks; t++)
+            if(parallel[t] != serial[t])
+              {
+                std::cout << (levelized ? "levelized" : "event") << " threads(" << r.threads
+                          << ", " << r.min_parts << ", " << r.grain << ") deviates at ["
+                          << t << "]" << std::endl;
+                failures++;
+                break;
+              }
+        }
+    }
+  std::cout << failures << " deviations" << std::endl;
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,164 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <tracer.hpp>
+
+using namespace hdl;
+
+detail::async_file::async_file(std::string filename, std::size_t buffer_size)
+  : file(std::fopen(filename.c_str(), "wb")), buffer_size(buffer_size),
+    writer(&async_file::write_loop, this)
+{
+  if(!file)
+    std::cerr << "ERROR: Could not open " << filename << " for writing." << std::endl;
+  cur.reserve(buffer_size);
+}
+
+detail::async_file::~async_file()
+{
+  close();
+}
+
+void detail::async_file::submit()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  written += cur.size();
+  full.push_back(std::string());
+  full.back().swap(cur);
+  if(empty.size() > 0)
+    {
+      cur.swap(empty.back());
+      empty.pop_back();
+    }
+  else
+    cur.reserve(buffer_size);
+  cond.notify_one();
+}
+
+void detail::async_file::write_loop()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while(true)
+    {
+      cond.wait(lock, [this] { return done || full.size() > 0; });
+      if(full.size() == 0)
+        break;
+      std::string buf;
+      buf.swap(full.front());
+      full.pop_front();
+
+      lock.unlock();
+      if(file)
+        std::fwrite(buf.data(), 1, buf.size(), file);
+      buf.clear();
+      lock.lock();
+
+      empty.push_back(std::string());
+      empty.back().swap(buf);
+    }
+}
+
+void detail::async_file::close()
+{
+  if(!writer.joinable())
+    return;
+  submit();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+  }
+  cond.notify_one();
+  writer.join();
+  if(file)
+    std::fclose(file);
+  file = NULL;
+}
+
+void tracer::add(probe *p)
+{
+  // the header has been written already
+  assert(!started);
+  probes.push_back(std::unique_ptr<probe>(p));
+}
+
+void tracer::changed(unsigned int wire_id)
+{
+  auto range = by_id.equal_range(wire_id);
+  for(auto i = range.first; i != range.second; i++)
+    if(!probes[i->second]->dirty)
+      {
+        probes[i->second]->dirty = true;
+        dirty.push_back(i->second);
+      }
+}
+
+// Called at the end of every time step. Only the final values of a
+// time step are passed on, not the ones of the delta cycles in between.
+void tracer::step(uint64_t time)
+{
+  if(!started)
+    {
+      header();
+      dump_begin(time);
+      for(unsigned int c = 0; c < probes.size(); c++)
+        {
+          probes[c]->value(probes[c]->last);
+          change(c, probes[c]->last);
+        }
+      dump_end();
+      started = true;
+    }
+  else if(dirty.size() > 0)
+    {
+      bool stamped = false;
+      std::string value;
+      std::sort(dirty.begin(), dirty.end());
+      for(auto n : dirty)
+        {
+          value.clear();
+          probes[n]->value(value);
+          if(value == probes[n]->last)
+            continue;
+          if(!stamped)
+            {
+              timestamp(time);
+              stamped = true;
+            }
+          change(n, value);
+          probes[n]->last.swap(value);
+        }
+    }
+  for(auto n : dirty)
+    probes[n]->dirty = false;
+  dirty.clear();
+  step_end();
+}
@@ -0,0 +1,316 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+
+#ifndef TRACER_HPP
+#define TRACER_HPP
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <base.hpp>
+#include <fixed.hpp>
+#include <logic_vector.hpp>
+#include <std_logic.hpp>
+#include <wire.hpp>
+
+namespace hdl
+{
+  namespace detail
+  {
+    // How values of a type are traced: as text of 0, 1, x and z from
+    // the most significant bit down, like in a VCD file, or as a real.
+    inline char trace_bit(bool b)
+    {
+      return b ? '1' : '0';
+    }
+
+    inline char trace_bit(const std_logic &s)
+    {
+      switch((char)s)
+        {
+        case '1':
+          return '1';
+        case '0':
+          return '0';
+        case 'Z':
+          return 'z';
+        default:
+          return 'x';
+        }
+    }
+
+    inline void trace_real(double d, std::string &out)
+    {
+      char buf[32];
+      std::snprintf(buf, sizeof(buf), "%.17g", d);
+      out += buf;
+    }
+
+    template <typename T, typename = void>
+    struct trace_traits;
+
+    template <>
+    struct trace_traits<bool>
+    {
+      static const unsigned int width = 1;
+      static void bits(const bool &b, std::string &out) { out += trace_bit(b); }
+      static double real(const bool &b) { return b; }
+    };
+
+    template <>
+    struct trace_traits<std_logic>
+    {
+      static const unsigned int width = 1;
+      static void bits(const std_logic &s, std::string &out) { out += trace_bit(s); }
+      static double real(const std_logic &s) { return (bool)s; }
+    };
+
+    template <typename T>
+    struct trace_traits<T, typename std::enable_if<std::is_integral<T>::value &&
+                                                 !std::is_same<T, bool>::value>::type>
+    {
+      static const unsigned int width = 8*sizeof(T);
+      static void bits(const T &t, std::string &out)
+      {
+        for(unsigned int c = width; c > 0; c--)
+          out += trace_bit((t >> (c-1)) & 1);
+      }
+      static double real(const T &t) { return t; }
+    };
+
+    template <bool sign, unsigned int mbits, unsigned int fbits>
+    struct trace_traits<fixed_t<sign, mbits, fbits> >
+    {
+      static const unsigned int width = mbits + fbits;
+      static void bits(const fixed_t<sign, mbits, fbits> &f, std::string &out)
+      {
+        for(unsigned int c = width; c > 0; c--)
+          out += trace_bit(f[c-1]);
+      }
+      static double real(const fixed_t<sign, mbits, fbits> &f) { return static_cast<double>(f); }
+    };
+
+    template <unsigned int N>
+    struct trace_traits<logic_vector<N> >
+    {
+      static const unsigned int width = N;
+      static void bits(const logic_vector<N> &v, std::string &out)
+      {
+        for(unsigned int c = width; c > 0; c--)
+          out += trace_bit(v[c-1]);
+      }
+      static double real(const logic_vector<N> &v) { return v.to_uint(); }
+    };
+
+    // A file written by a background thread. The owner fills buffer()
+    // and hands it over with submit() once it is large enough.
+    class async_file
+    {
+    private:
+      std::FILE *file;
+      std::size_t buffer_size;
+      uint64_t written = 0;
+
+      std::string cur;
+      std::deque<std::string> full;
+      std::vector<std::string> empty;
+      std::mutex mutex;
+      std::condition_variable cond;
+      bool done = false;
+      std::thread writer;
+
+      void write_loop();
+
+    public:
+      async_file(std::string filename, std::size_t buffer_size);
+      ~async_file();
+      async_file(const async_file&) = delete;
+      async_file &operator=(const async_file&) = delete;
+
+      inline std::string &buffer()
+      {
+        return cur;
+      }
+
+      // file offset of the end of buffer()
+      inline uint64_t offset() const
+      {
+        return written + cur.size();
+      }
+
+      // hand the buffer over if it is full
+      inline void flush()
+      {
+        if(cur.size() >= buffer_size)
+          submit();
+      }
+
+      void submit();
+      void close();
+    };
+  }
+
+  // Records the values of wires and buses while a simulator runs, see
+  // simulator::trace(). Once per time step, the final values of the
+  // traced objects that changed are handed to the derived class.
+  class tracer
+  {
+  public:
+    enum format { vector, real };
+
+  protected:
+    // one traced object
+    class probe
+    {
+    public:
+      std::vector<std::shared_ptr<detail::base> > wires;
+      unsigned int width;
+      bool is_real;
+      bool dirty = false;
+      std::string last;
+
+      probe(unsigned int width, bool is_real)
+        : width(width), is_real(is_real)
+      {
+      }
+
+      virtual ~probe() {}
+      virtual std::string getname() const = 0;
+      virtual void value(std::string &out) const = 0;
+    };
+
+    std::vector<std::unique_ptr<probe> > probes;
+
+    // the probes are complete, the first values follow
+    virtual void header() = 0;
+    virtual void dump_begin(uint64_t time) = 0;
+    virtual void dump_end() = 0;
+
+    // values that changed in a time step, in the order of the probes
+    virtual void timestamp(uint64_t time) = 0;
+    virtual void change(unsigned int n, const std::string &value) = 0;
+    virtual void step_end() { }
+
+  private:
+    template <typename T>
+    class wire_probe : public probe
+    {
+    private:
+      wire<T> w;
+
+    public:
+      wire_probe(wire<T> w, format f)
+        : probe(detail::trace_traits<T>::width, f == real), w(w)
+      {
+        wires.push_back(w);
+      }
+
+      std::string getname() const
+      {
+        return w.getname();
+      }
+
+      void value(std::string &out) const
+      {
+        if(is_real)
+          detail::trace_real(detail::trace_traits<T>::real(w.get()), out);
+        else
+          detail::trace_traits<T>::bits(w.get(), out);
+      }
+    };
+
+    template <typename T, unsigned int bits>
+    class bus_probe : public probe
+    {
+    private:
+      bus<T, bits> b;
+
+    public:
+      bus_probe(bus<T, bits> b)
+        : probe(bits, false), b(b)
+      {
+        for(unsigned int c = 0; c < bits; c++)
+          wires.push_back(b[c]);
+      }
+
+      std::string getname() const
+      {
+        return b.getname();
+      }
+
+      void value(std::string &out) const
+      {
+        for(unsigned int c = bits; c > 0; c--)
+          out += detail::trace_bit(b[c-1].get());
+      }
+    };
+
+    // traced wires by id, filled in by the simulator
+    std::unordered_multimap<unsigned int, unsigned int> by_id;
+    std::vector<unsigned int> dirty;
+    bool started = false;
+
+    void add(probe *p);
+
+    // called by the simulator
+    void changed(unsigned int wire_id);
+    void step(uint64_t time);
+
+    friend class simulator;
+
+  public:
+    tracer() = default;
+    tracer(const tracer&) = delete;
+    tracer &operator=(const tracer&) = delete;
+    virtual ~tracer() {}
+
+    // Everything has to be traced before the first time step.
+    template <typename T>
+    void trace(wire<T> w, format f = vector)
+    {
+      add(new wire_probe<T>(w, f));
+    }
+
+    template <typename T, unsigned int width>
+    void trace(bus<T, width> b)
+    {
+      add(new bus_probe<T, width>(b));
+    }
+  };
+}
+
+#endif
@@ -0,0 +1,168 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+
+#include <algorithm>
+#include <vcd.hpp>
+
+using namespace hdl;
+
+// numbers in base 94 using the printable characters
+std::string detail::vcd_code(unsigned int n)
+{
+  std::string code;
+  do
+    {
+      code += static_cast<char>('!' + n % 94);
+      n /= 94;
+    }
+  while(n > 0);
+  return code;
+}
+
+void detail::vcd_header(std::string &out, std::string timescale,
+                        const std::vector<vcd_var> &vars)
+{
+  out += "$version libhdlsim $end\n";
+  out += "$timescale " + timescale + " $end\n";
+
+  // Scopes are the names up to the last dot, names without one go into
+  // the scope top.
+  std::vector<std::pair<std::vector<std::string>, unsigned int> > paths;
+  for(unsigned int c = 0; c < vars.size(); c++)
+    {
+      std::vector<std::string> path;
+      std::string name = vars[c].name;
+      std::size_t pos;
+      while((pos = name.find('.')) != std::string::npos)
+        {
+          path.push_back(name.substr(0, pos));
+          name = name.substr(pos+1);
+        }
+      path.push_back(name);
+      if(path.size() == 1)
+        path.insert(path.begin(), "top");
+      paths.push_back(std::make_pair(path, c));
+    }
+  std::stable_sort(paths.begin(), paths.end(),
+                   [] (const std::pair<std::vector<std::string>, unsigned int> &a,
+                       const std::pair<std::vector<std::string>, unsigned int> &b)
+                   {
+                     return std::lexicographical_compare(a.first.begin(), a.first.end()-1,
+                                                         b.first.begin(), b.first.end()-1);
+                   });
+
+  std::vector<std::string> open;
+  for(auto &p : paths)
+    {
+      std::vector<std::string> scope(p.first.begin(), p.first.end()-1);
+      unsigned int common = 0;
+      while(common < open.size() && common < scope.size() && open[common] == scope[common])
+        common++;
+      for(; open.size() > common; open.pop_back())
+        out += "$upscope $end\n";
+      for(; open.size() < scope.size(); open.push_back(scope[open.size()]))
+        out += "$scope module " + scope[open.size()] + " $end\n";
+
+      const vcd_var &v = vars[p.second];
+      if(v.is_real)
+        out += "$var real 64 " + v.code + " " + p.first.back() + " $end\n";
+      else if(v.width == 1)
+        out += "$var wire 1 " + v.code + " " + p.first.back() + " $end\n";
+      else
+        out += "$var wire " + std::to_string(v.width) + " " + v.code + " "
+          + p.first.back() + " [" + std::to_string(v.width-1) + ":0] $end\n";
+    }
+  for(; open.size() > 0; open.pop_back())
+    out += "$upscope $end\n";
+  out += "$enddefinitions $end\n";
+}
+
+void detail::vcd_value(std::string &out, const vcd_var &var, const std::string &value)
+{
+  if(var.is_real)
+    out += "r" + value + " " + var.code + "\n";
+  else if(var.width == 1)
+    out += value + var.code + "\n";
+  else
+    out += "b" + value + " " + var.code + "\n";
+}
+
+vcd::vcd(std::string filename, std::string timescale, std::size_t buffer_size)
+  : file(filename, buffer_size), timescale(timescale)
+{
+}
+
+vcd::~vcd()
+{
+  close();
+}
+
+void vcd::header()
+{
+  for(unsigned int c = 0; c < probes.size(); c++)
+    {
+      detail::vcd_var v;
+      v.name = probes[c]->getname();
+      v.code = detail::vcd_code(c);
+      v.width = probes[c]->width;
+      v.is_real = probes[c]->is_real;
+      vars.push_back(v);
+    }
+  detail::vcd_header(file.buffer(), timescale, vars);
+}
+
+void vcd::dump_begin(uint64_t time)
+{
+  file.buffer() += "#" + std::to_string(time) + "\n$dumpvars\n";
+}
+
+void vcd::dump_end()
+{
+  file.buffer() += "$end\n";
+}
+
+void vcd::timestamp(uint64_t time)
+{
+  file.buffer() += "#" + std::to_string(time) + "\n";
+}
+
+void vcd::change(unsigned int n, const std::string &value)
+{
+  detail::vcd_value(file.buffer(), vars[n], value);
+}
+
+void vcd::step_end()
+{
+  file.flush();
+}
+
+void vcd::close()
+{
+  file.close();
+}
@@ -0,0 +1,88 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+
+#ifndef VCD_HPP
+#define VCD_HPP
+
+#include <string>
+#include <vector>
+#include <tracer.hpp>
+
+namespace hdl
+{
+  namespace detail
+  {
+    struct vcd_var
+    {
+      std::string name;
+      std::string code;
+      unsigned int width;
+      bool is_real;
+    };
+
+    // identifier of the n-th variable
+    std::string vcd_code(unsigned int n);
+
+    // Declarations of all variables. Dots in their names (e.g.
+    // "cpu.alu.sum") become scopes, names without dots are put into a
+    // scope top.
+    void vcd_header(std::string &out, std::string timescale,
+                    const std::vector<vcd_var> &vars);
+
+    void vcd_value(std::string &out, const vcd_var &var, const std::string &value);
+  }
+
+  // Writes the values of traced wires into a Value Change Dump. Value
+  // changes are formatted into large buffers, which a background
+  // thread writes to the file.
+  class vcd : public tracer
+  {
+  private:
+    detail::async_file file;
+    std::string timescale;
+    std::vector<detail::vcd_var> vars;
+
+    void header();
+    void dump_begin(uint64_t time);
+    void dump_end();
+    void timestamp(uint64_t time);
+    void change(unsigned int n, const std::string &value);
+    void step_end();
+
+  public:
+    vcd(std::string filename, std::string timescale = "1 ns",
+        std::size_t buffer_size = 1 << 20);
+    ~vcd();
+
+    // write everything and close the file
+    void close();
+  };
+}
+
+#endif
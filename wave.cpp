@@ -0,0 +1,539 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <lz.hpp>
+#include <vcd.hpp>
+#include <wave.hpp>
+
+using namespace hdl;
+
+namespace
+{
+  const char file_magic[8] = { 'H', 'D', 'L', 'W', 'A', 'V', 'E', '1' };
+  const char block_magic[4] = { 'B', 'L', 'K', '1' };
+  const char index_magic[4] = { 'I', 'D', 'X', '1' };
+  const char end_magic[8] = { 'H', 'D', 'L', 'W', 'E', 'N', 'D', '1' };
+
+  // magic, raw size, compressed size, first and last time
+  const std::size_t block_header = 4 + 4 + 4 + 8 + 8;
+
+  void put_u32(std::string &out, uint32_t v)
+  {
+    for(unsigned int c = 0; c < 4; c++)
+      out += static_cast<char>(v >> (8*c));
+  }
+
+  void put_u64(std::string &out, uint64_t v)
+  {
+    for(unsigned int c = 0; c < 8; c++)
+      out += static_cast<char>(v >> (8*c));
+  }
+
+  uint32_t get_u32(const char *p)
+  {
+    uint32_t v = 0;
+    for(unsigned int c = 0; c < 4; c++)
+      v |= static_cast<uint32_t>(static_cast<unsigned char>(p[c])) << (8*c);
+    return v;
+  }
+
+  uint64_t get_u64(const char *p)
+  {
+    uint64_t v = 0;
+    for(unsigned int c = 0; c < 8; c++)
+      v |= static_cast<uint64_t>(static_cast<unsigned char>(p[c])) << (8*c);
+    return v;
+  }
+
+  // seven bits per byte, lowest first
+  void put_varint(std::string &out, uint64_t v)
+  {
+    for(; v >= 0x80; v >>= 7)
+      out += static_cast<char>(v | 0x80);
+    out += static_cast<char>(v);
+  }
+
+  bool get_varint(const char *&p, const char *end, uint64_t &v)
+  {
+    v = 0;
+    for(unsigned int shift = 0; p < end && shift < 64; shift += 7)
+      {
+        unsigned char b = *p++;
+        v |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if(!(b & 0x80))
+          return true;
+      }
+    return false;
+  }
+
+  std::size_t value_size(unsigned int width, bool is_real)
+  {
+    return is_real ? 8 : (width + 3) / 4;
+  }
+
+  void encode(const std::string &text, unsigned int width, bool is_real, std::string &out)
+  {
+    if(is_real)
+      {
+        double d = std::strtod(text.c_str(), NULL);
+        uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(d));
+        put_u64(out, bits);
+        return;
+      }
+    std::size_t first = out.size();
+    out.resize(first + value_size(width, false), 0);
+    for(unsigned int c = 0; c < width && c < text.size(); c++)
+      {
+        unsigned int code = text[c] == '1' ? 1 : text[c] == 'z' ? 2 : text[c] == 'x' ? 3 : 0;
+        out[first + c/4] |= code << (2*(c%4));
+      }
+  }
+
+  std::string decode(const char *p, unsigned int width, bool is_real)
+  {
+    std::string text;
+    if(is_real)
+      {
+        uint64_t bits = get_u64(p);
+        double d;
+        std::memcpy(&d, &bits, sizeof(d));
+        detail::trace_real(d, text);
+        return text;
+      }
+    static const char chars[4] = { '0', '1', 'z', 'x' };
+    text.resize(width);
+    for(unsigned int c = 0; c < width; c++)
+      text[c] = chars[(static_cast<unsigned char>(p[c/4]) >> (2*(c%4))) & 3];
+    return text;
+  }
+}
+
+wave::wave(std::string filename, std::string timescale, std::size_t block_size)
+  : file(filename, 1 << 20), timescale(timescale), block_size(block_size)
+{
+}
+
+wave::~wave()
+{
+  close();
+}
+
+void wave::header()
+{
+  std::string h;
+  put_varint(h, probes.size());
+  for(auto &p : probes)
+    {
+      std::string name = p->getname();
+      put_varint(h, name.size());
+      h += name;
+      put_varint(h, p->width);
+      h += static_cast<char>(p->is_real);
+    }
+  put_varint(h, timescale.size());
+  h += timescale;
+
+  std::string &buf = file.buffer();
+  buf.append(file_magic, sizeof(file_magic));
+  put_u32(buf, h.size());
+  buf += h;
+
+  current.resize(probes.size());
+  columns.resize(probes.size());
+  nchanges.resize(probes.size());
+  last_change.resize(probes.size());
+  have_header = true;
+}
+
+void wave::dump_begin(uint64_t time)
+{
+  dumping = true;
+  now = time;
+}
+
+void wave::dump_end()
+{
+  dumping = false;
+  start_block(now);
+}
+
+void wave::start_block(uint64_t time)
+{
+  block_first = block_last = time;
+  key = current;
+  for(unsigned int c = 0; c < columns.size(); c++)
+    {
+      columns[c].clear();
+      nchanges[c] = 0;
+      last_change[c] = time;
+    }
+  raw_size = 0;
+  block_open = true;
+}
+
+void wave::finish_block()
+{
+  std::string raw;
+  for(auto &k : key)
+    raw += k;
+  for(unsigned int c = 0; c < columns.size(); c++)
+    {
+      put_varint(raw, nchanges[c]);
+      raw += columns[c];
+    }
+  std::string packed;
+  detail::lz_compress(raw.data(), raw.size(), packed);
+
+  index_entry e;
+  e.offset = file.offset();
+  e.first = block_first;
+  e.last = block_last;
+  index.push_back(e);
+
+  std::string &buf = file.buffer();
+  buf.append(block_magic, sizeof(block_magic));
+  put_u32(buf, raw.size());
+  put_u32(buf, packed.size());
+  put_u64(buf, block_first);
+  put_u64(buf, block_last);
+  buf += packed;
+  file.flush();
+  block_open = false;
+}
+
+void wave::timestamp(uint64_t time)
+{
+  if(raw_size >= block_size)
+    {
+      finish_block();
+      start_block(time);
+    }
+  now = time;
+  block_last = time;
+}
+
+void wave::change(unsigned int n, const std::string &value)
+{
+  std::string enc;
+  encode(value, probes[n]->width, probes[n]->is_real, enc);
+  if(!dumping)
+    {
+      std::size_t old = columns[n].size();
+      put_varint(columns[n], now - last_change[n]);
+      columns[n] += enc;
+      raw_size += columns[n].size() - old;
+      last_change[n] = now;
+      nchanges[n]++;
+    }
+  current[n].swap(enc);
+}
+
+void wave::step_end()
+{
+  file.flush();
+}
+
+void wave::close()
+{
+  if(closed)
+    return;
+  closed = true;
+  if(!have_header)
+    header();
+  if(block_open)
+    finish_block();
+
+  uint64_t at = file.offset();
+  std::string &buf = file.buffer();
+  buf.append(index_magic, sizeof(index_magic));
+  put_u64(buf, index.size());
+  for(auto &e : index)
+    {
+      put_u64(buf, e.offset);
+      put_u64(buf, e.first);
+      put_u64(buf, e.last);
+    }
+  put_u64(buf, at);
+  buf.append(end_magic, sizeof(end_magic));
+  file.close();
+}
+
+wave_reader::wave_reader(std::string filename)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if(fd < 0)
+    {
+      std::cerr << "ERROR: Could not open " << filename << "." << std::endl;
+      return;
+    }
+  struct stat st;
+  if(fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+      void *m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if(m != MAP_FAILED)
+        {
+          data = static_cast<const char*>(m);
+          size = st.st_size;
+        }
+    }
+  ::close(fd);
+
+  ok = data && parse();
+  if(!ok)
+    std::cerr << "ERROR: " << filename << " is not a valid waveform file." << std::endl;
+}
+
+wave_reader::~wave_reader()
+{
+  if(data)
+    munmap(const_cast<char*>(data), size);
+}
+
+bool wave_reader::parse()
+{
+  if(size < sizeof(file_magic) + 4 || std::memcmp(data, file_magic, sizeof(file_magic)) != 0)
+    return false;
+  std::size_t pos = sizeof(file_magic) + 4;
+  std::size_t hlen = get_u32(data + sizeof(file_magic));
+  if(hlen > size - pos)
+    return false;
+
+  const char *p = data + pos;
+  const char *end = p + hlen;
+  uint64_t n, len;
+  if(!get_varint(p, end, n))
+    return false;
+  for(uint64_t c = 0; c < n; c++)
+    {
+      signal s;
+      uint64_t width;
+      if(!get_varint(p, end, len) || len > static_cast<uint64_t>(end - p))
+        return false;
+      s.name.assign(p, len);
+      p += len;
+      if(!get_varint(p, end, width) || p >= end)
+        return false;
+      s.width = width;
+      s.is_real = *p++;
+      sigs.push_back(s);
+    }
+  if(!get_varint(p, end, len) || len > static_cast<uint64_t>(end - p))
+    return false;
+  scale.assign(p, len);
+  pos += hlen;
+
+  // the index at the end of the file
+  const std::size_t trailer = 8 + sizeof(end_magic);
+  if(size >= pos + trailer && std::memcmp(data + size - sizeof(end_magic), end_magic, sizeof(end_magic)) == 0)
+    {
+      uint64_t at = get_u64(data + size - trailer);
+      if(at < pos || at + 12 > size - trailer ||
+         std::memcmp(data + at, index_magic, sizeof(index_magic)) != 0)
+        return false;
+      uint64_t count = get_u64(data + at + 4);
+      if(count > (size - trailer - at - 12) / 24)
+        return false;
+      for(uint64_t c = 0; c < count; c++)
+        {
+          const char *e = data + at + 12 + 24*c;
+          block b;
+          b.offset = get_u64(e);
+          b.first = get_u64(e + 8);
+          b.last = get_u64(e + 16);
+          blocks.push_back(b);
+        }
+      return true;
+    }
+
+  // no index (the writer has not been closed), walk the blocks
+  while(size - pos >= block_header && std::memcmp(data + pos, block_magic, sizeof(block_magic)) == 0)
+    {
+      std::size_t packed = get_u32(data + pos + 8);
+      if(packed > size - pos - block_header)
+        break;
+      block b;
+      b.offset = pos;
+      b.first = get_u64(data + pos + 12);
+      b.last = get_u64(data + pos + 20);
+      blocks.push_back(b);
+      pos += block_header + packed;
+    }
+  return true;
+}
+
+bool wave_reader::decode(const block &b, std::vector<std::string> &key,
+                         std::vector<std::pair<std::pair<uint64_t, unsigned int>, std::string> > &events) const
+{
+  if(b.offset > size || size - b.offset < block_header ||
+     std::memcmp(data + b.offset, block_magic, sizeof(block_magic)) != 0)
+    return false;
+  std::size_t raw_size = get_u32(data + b.offset + 4);
+  std::size_t packed = get_u32(data + b.offset + 8);
+  if(packed > size - b.offset - block_header)
+    return false;
+  std::vector<char> raw(raw_size);
+  if(!detail::lz_decompress(data + b.offset + block_header, packed, raw.data(), raw_size))
+    return false;
+
+  const char *p = raw.data();
+  const char *end = p + raw_size;
+  key.resize(sigs.size());
+  for(unsigned int c = 0; c < sigs.size(); c++)
+    {
+      std::size_t vs = value_size(sigs[c].width, sigs[c].is_real);
+      if(vs > static_cast<std::size_t>(end - p))
+        return false;
+      key[c] = ::decode(p, sigs[c].width, sigs[c].is_real);
+      p += vs;
+    }
+
+  events.clear();
+  for(unsigned int c = 0; c < sigs.size(); c++)
+    {
+      std::size_t vs = value_size(sigs[c].width, sigs[c].is_real);
+      uint64_t count, delta;
+      uint64_t time = b.first;
+      if(!get_varint(p, end, count))
+        return false;
+      for(uint64_t e = 0; e < count; e++)
+        {
+          if(!get_varint(p, end, delta) || vs > static_cast<std::size_t>(end - p))
+            return false;
+          time += delta;
+          events.push_back(std::make_pair(std::make_pair(time, c), ::decode(p, sigs[c].width, sigs[c].is_real)));
+          p += vs;
+        }
+    }
+  std::sort(events.begin(), events.end(),
+            [] (const std::pair<std::pair<uint64_t, unsigned int>, std::string> &a,
+                const std::pair<std::pair<uint64_t, unsigned int>, std::string> &b)
+            {
+              return a.first < b.first;
+            });
+  return true;
+}
+
+uint64_t wave_reader::begin_time() const
+{
+  return blocks.size() > 0 ? blocks.front().first : 0;
+}
+
+uint64_t wave_reader::end_time() const
+{
+  return blocks.size() > 0 ? blocks.back().last : 0;
+}
+
+bool wave_reader::read(uint64_t from, uint64_t to, callback f) const
+{
+  if(!ok)
+    return false;
+  if(blocks.size() == 0)
+    return true;
+
+  // first block that ends at or after from
+  auto b = std::lower_bound(blocks.begin(), blocks.end(), from,
+                            [] (const block &x, uint64_t t) { return x.last < t; });
+  if(b == blocks.end())
+    b--;
+
+  std::vector<std::string> values, unused;
+  std::vector<std::pair<std::pair<uint64_t, unsigned int>, std::string> > events;
+  if(!decode(*b, values, events))
+    return false;
+
+  std::size_t e = 0;
+  for(; e < events.size() && events[e].first.first <= from; e++)
+    values[events[e].first.second].swap(events[e].second);
+  for(unsigned int c = 0; c < sigs.size(); c++)
+    f(from, c, values[c]);
+
+  while(true)
+    {
+      for(; e < events.size() && events[e].first.first <= to; e++)
+        f(events[e].first.first, events[e].first.second, events[e].second);
+      if(e < events.size())
+        return true;
+      if(++b == blocks.end() || b->first > to)
+        return true;
+      if(!decode(*b, unused, events))
+        return false;
+      e = 0;
+    }
+}
+
+bool wave_reader::write_vcd(std::string filename, uint64_t from, uint64_t to) const
+{
+  std::vector<detail::vcd_var> vars;
+  for(unsigned int c = 0; c < sigs.size(); c++)
+    {
+      detail::vcd_var v;
+      v.name = sigs[c].name;
+      v.code = detail::vcd_code(c);
+      v.width = sigs[c].width;
+      v.is_real = sigs[c].is_real;
+      vars.push_back(v);
+    }
+
+  detail::async_file out(filename, 1 << 20);
+  detail::vcd_header(out.buffer(), scale, vars);
+  out.buffer() += "#" + std::to_string(from) + "\n$dumpvars\n";
+
+  unsigned int initial = vars.size();
+  uint64_t now = from;
+  bool good = read(from, to, [&] (uint64_t time, unsigned int signal, const std::string &value)
+                   {
+                     if(initial > 0)
+                       {
+                         detail::vcd_value(out.buffer(), vars[signal], value);
+                         if(--initial == 0)
+                           out.buffer() += "$end\n";
+                         return;
+                       }
+                     if(time != now)
+                       {
+                         out.buffer() += "#" + std::to_string(time) + "\n";
+                         now = time;
+                       }
+                     detail::vcd_value(out.buffer(), vars[signal], value);
+                     out.flush();
+                   });
+  if(vars.size() == 0)
+    out.buffer() += "$end\n";
+  out.close();
+  return good;
+}
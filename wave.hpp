@@ -0,0 +1,160 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+
+#ifndef WAVE_HPP
+#define WAVE_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include <tracer.hpp>
+
+namespace hdl
+{
+  // Compact binary waveforms. The file consists of
+  //   - a header with the names, widths and kinds of all signals,
+  //   - blocks, each holding the values of all signals at its start
+  //     and per signal the changes as time deltas and values, LZ
+  //     compressed,
+  //   - an index with the offset and time range of every block.
+  // A reader can start at any block, so seeking to a time window only
+  // decodes the blocks covering it. Bits are stored with two bits each
+  // (0, 1, z, x), reals as doubles. All numbers are little endian.
+  class wave : public tracer
+  {
+  private:
+    detail::async_file file;
+    std::string timescale;
+    std::size_t block_size;
+
+    // encoded current value and changes in the open block per signal
+    std::vector<std::string> current;
+    std::vector<std::string> key;
+    std::vector<std::string> columns;
+    std::vector<uint32_t> nchanges;
+    std::vector<uint64_t> last_change;
+    std::size_t raw_size = 0;
+    uint64_t block_first = 0;
+    uint64_t block_last = 0;
+    uint64_t now = 0;
+    bool dumping = false;
+    bool block_open = false;
+    bool have_header = false;
+    bool closed = false;
+
+    struct index_entry
+    {
+      uint64_t offset;
+      uint64_t first;
+      uint64_t last;
+    };
+    std::vector<index_entry> index;
+
+    void start_block(uint64_t time);
+    void finish_block();
+
+    void header();
+    void dump_begin(uint64_t time);
+    void dump_end();
+    void timestamp(uint64_t time);
+    void change(unsigned int n, const std::string &value);
+    void step_end();
+
+  public:
+    // block_size is the uncompressed size after which a new block is
+    // started.
+    wave(std::string filename, std::string timescale = "1 ns",
+         std::size_t block_size = 1 << 20);
+    ~wave();
+
+    // write the last block and the index and close the file
+    void close();
+  };
+
+  // Reads a waveform file written by wave. The file is mapped into
+  // memory, only the blocks needed for a time window are decoded.
+  class wave_reader
+  {
+  public:
+    struct signal
+    {
+      std::string name;
+      unsigned int width;
+      bool is_real;
+    };
+
+    // Values are passed as text like in a VCD file: 0, 1, z and x from
+    // the most significant bit down, or a real number.
+    typedef std::function<void(uint64_t time, unsigned int signal,
+                               const std::string &value)> callback;
+
+  private:
+    const char *data = NULL;
+    std::size_t size = 0;
+    bool ok = false;
+    std::string scale;
+    std::vector<signal> sigs;
+
+    struct block
+    {
+      std::size_t offset;
+      uint64_t first;
+      uint64_t last;
+    };
+    std::vector<block> blocks;
+
+    bool parse();
+    bool decode(const block &b, std::vector<std::string> &key,
+                std::vector<std::pair<std::pair<uint64_t, unsigned int>, std::string> > &events) const;
+
+  public:
+    wave_reader(std::string filename);
+    ~wave_reader();
+    wave_reader(const wave_reader&) = delete;
+    wave_reader &operator=(const wave_reader&) = delete;
+
+    bool good() const { return ok; }
+    const std::vector<signal> &signals() const { return sigs; }
+    std::string timescale() const { return scale; }
+    uint64_t begin_time() const;
+    uint64_t end_time() const;
+
+    // Calls f with the values of all signals at time from, then with
+    // every change up to and including time to. Returns false if the
+    // file is damaged.
+    bool read(uint64_t from, uint64_t to, callback f) const;
+
+    // Writes the same time window as a VCD file, which is identical to
+    // the one hdl::vcd writes if the window covers the whole file.
+    bool write_vcd(std::string filename, uint64_t from, uint64_t to) const;
+  };
+}
+
+#endif
@@ -0,0 +1,59 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <wave.hpp>
+
+using namespace hdl;
+
+// Converts a waveform written by hdl::wave into a VCD file,
+// optionally only the time window from .. to.
+int main(int argc, char **argv)
+{
+  if(argc < 3)
+    {
+      std::cerr << "Usage: " << argv[0] << " <input> <output.vcd> [from [to]]" << std::endl;
+      return 1;
+    }
+
+  wave_reader in(argv[1]);
+  if(!in.good())
+    return 1;
+  uint64_t from = argc > 3 ? std::strtoull(argv[3], NULL, 10) : in.begin_time();
+  uint64_t to = argc > 4 ? std::strtoull(argv[4], NULL, 10) : std::numeric_limits<uint64_t>::max();
+
+  if(!in.write_vcd(argv[2], from, to))
+    {
+      std::cerr << "ERROR: " << argv[1] << " is damaged." << std::endl;
+      return 1;
+    }
+  return 0;
+}
@@ -0,0 +1,266 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <hdlsim.hpp>
+
+using namespace hdl;
+
+// Checks the binary waveforms of hdl::wave:
+//  - converted to VCD they are byte by byte what hdl::vcd writes,
+//  - reading any time window gives the values and changes of a full
+//    read, also for windows that start or end at a block boundary,
+//  - truncated files give a prefix of the changes and corrupted ones
+//    are read without crashing.
+// Small blocks make sure there are many block boundaries.
+// Exits with 1 if something deviates.
+
+namespace
+{
+  const uint64_t ticks = 400;
+  const char *vcd_file = "wavecheck.vcd";
+  const char *wave_file = "wavecheck.wave";
+  const char *converted_file = "wavecheck.wave.vcd";
+  const char *damaged_file = "wavecheck.damaged";
+
+  unsigned int failures = 0;
+
+  void fail(const std::string &what)
+  {
+    std::cout << what << std::endl;
+    failures++;
+  }
+
+  // the same design and time steps for every tracer
+  void record(tracer &t)
+  {
+    context ctx;
+    context::scope bind(ctx);
+
+    wire<std_logic> clk, reset, one(1), bus;
+    wire<fixed_t<false, 12, 0> > count;
+    wire<logic_vector<70> > vec;
+    clk.setname("clk");
+    reset.setname("reset");
+    bus.setname("cpu.bus");
+    count.setname("cpu.alu.count");
+    vec.setname("cpu.vec");
+    counter(clk, reset, one, count);
+
+    std::shared_ptr<std::mt19937> rng(new std::mt19937(1));
+    part tb({}, { { clk, reset, bus, vec } }, [=] (uint64_t t)
+            {
+              clk = t % 2;
+              reset = t >= 4;
+              unsigned int r = (*rng)();
+              if(r % 3 == 0)
+                bus = std_logic().z();
+              else if(r % 3 == 1)
+                bus = std_logic(t % 4 < 2);
+              if(r % 5 == 0)
+                {
+                  logic_vector<70> v(static_cast<uint64_t>((*rng)()) << 20 | r);
+                  v.set(69, r & 8 ? std_logic().z() : std_logic());
+                  vec = v;
+                }
+            }, "tb");
+
+    t.trace(clk);
+    t.trace(reset);
+    t.trace(bus);
+    t.trace(count);
+    t.trace(count, tracer::real);
+    t.trace(vec);
+
+    simulator sim(tb);
+    sim.trace(t);
+    sim.run(ticks);
+  }
+
+  std::string contents(const char *name)
+  {
+    std::ifstream in(name, std::ios::binary);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+  }
+
+  struct change
+  {
+    uint64_t time;
+    unsigned int signal;
+    std::string value;
+
+    bool operator==(const change &c) const
+    {
+      return time == c.time && signal == c.signal && value == c.value;
+    }
+  };
+
+  bool read(const wave_reader &r, uint64_t from, uint64_t to, std::vector<change> &out)
+  {
+    out.clear();
+    return r.read(from, to, [&] (uint64_t time, unsigned int signal, const std::string &value)
+                  {
+                    out.push_back({ time, signal, value });
+                  });
+  }
+
+  void windows()
+  {
+    wave_reader r(wave_file);
+    std::vector<change> all, window;
+    if(!read(r, r.begin_time(), r.end_time(), all))
+      {
+        fail("full read failed");
+        return;
+      }
+    unsigned int n = r.signals().size();
+
+    // values at from and the changes up to to, taken from the full read
+    for(uint64_t from = r.begin_time(); from <= r.end_time(); from++)
+      for(uint64_t length : { 0, 1, 7, 50 })
+        {
+          uint64_t to = from + length;
+          std::vector<change> expected;
+          for(unsigned int c = 0; c < n; c++)
+            expected.push_back(all[c]);
+          for(std::size_t e = n; e < all.size(); e++)
+            if(all[e].time <= from)
+              expected[all[e].signal].value = all[e].value;
+            else if(all[e].time <= to)
+              expected.push_back(all[e]);
+          for(unsigned int c = 0; c < n; c++)
+            expected[c].time = from;
+          if(!read(r, from, to, window) || !(window == expected))
+            {
+              std::stringstream ss;
+              ss << "window " << from << " .. " << to << " deviates";
+              fail(ss.str());
+              return;
+            }
+        }
+  }
+
+  void write(const char *name, const std::string &data)
+  {
+    std::ofstream out(name, std::ios::binary);
+    out << data;
+  }
+
+  // Cuts the file at many places. Without the index the reader walks
+  // the complete blocks, so it has to give a prefix of the changes.
+  void truncated()
+  {
+    std::string data = contents(wave_file);
+    std::vector<change> all, part;
+    {
+      wave_reader r(wave_file);
+      read(r, r.begin_time(), r.end_time(), all);
+    }
+    for(std::size_t size = 0; size < data.size(); size += 1 + size / 16)
+      {
+        write(damaged_file, data.substr(0, size));
+        wave_reader r(damaged_file);
+        if(!r.good())
+          continue;
+        if(!read(r, r.begin_time(), r.end_time(), part) ||
+           part.size() > all.size() || !std::equal(part.begin(), part.end(), all.begin()))
+          {
+            std::stringstream ss;
+            ss << "file cut at " << size << " bytes gives changes that were not recorded";
+            fail(ss.str());
+            return;
+          }
+      }
+  }
+
+  // Overwrites single bytes. There are no checksums, so the values may
+  // be wrong, but reading must not crash or run away.
+  void corrupted()
+  {
+    std::string data = contents(wave_file);
+    std::mt19937 rng(2);
+    for(std::size_t pos = 0; pos < data.size(); pos += 1 + pos / 64)
+      {
+        std::string bad = data;
+        bad[pos] = static_cast<char>(rng());
+        write(damaged_file, bad);
+        wave_reader r(damaged_file);
+        std::vector<change> out;
+        if(r.good())
+          read(r, r.begin_time(), r.end_time(), out);
+        if(r.good() && out.size() > 0 && out.size() < r.signals().size())
+          {
+            std::stringstream ss;
+            ss << "corrupted byte " << pos << " gives incomplete initial values";
+            fail(ss.str());
+          }
+      }
+  }
+}
+
+int main()
+{
+  {
+    vcd v(vcd_file);
+    record(v);
+  }
+  {
+    wave w(wave_file, "1 ns", 256);
+    record(w);
+  }
+
+  {
+    wave_reader r(wave_file);
+    if(!r.good() || !r.write_vcd(converted_file, r.begin_time(), r.end_time()))
+      fail("converting to VCD failed");
+    else if(contents(converted_file) != contents(vcd_file))
+      fail("VCD converted from the waveform differs from the one written directly");
+  }
+
+  windows();
+
+  // the reader complains about every damaged file
+  std::streambuf *err = std::cerr.rdbuf(NULL);
+  truncated();
+  corrupted();
+  std::cerr.rdbuf(err);
+  std::cerr.clear();
+
+  for(const char *f : { vcd_file, wave_file, converted_file, damaged_file })
+    std::remove(f);
+  std::cout << failures << " deviations" << std::endl;
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,98 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+#include <cassert>
+#include <wheel.hpp>
+
+using namespace hdl;
+
+detail::event_wheel::event_wheel()
+  : ring(slots)
+{
+}
+
+void detail::event_wheel::schedule(uint64_t time, base *p)
+{
+  assert(time >= now);
+  if(time - now < slots)
+    {
+      ring[time % slots].push_back(p);
+      count++;
+    }
+  else
+    overflow.insert(std::make_pair(time, p));
+}
+
+bool detail::event_wheel::empty() const
+{
+  return count == 0 && overflow.empty();
+}
+
+uint64_t detail::event_wheel::next() const
+{
+  if(count > 0)
+    for(unsigned int c = 0; c < slots; c++)
+      if(ring[(now + c) % slots].size() > 0)
+        return now + c;
+  return overflow.begin()->first;
+}
+
+void detail::event_wheel::pop(uint64_t time, std::vector<base*> &due)
+{
+  assert(time >= now);
+  // nothing may be skipped when jumping ahead
+  assert(empty() || next() >= time);
+
+  now = time;
+  auto &bucket = ring[time % slots];
+  count -= bucket.size();
+  due.insert(due.end(), bucket.begin(), bucket.end());
+  bucket.clear();
+
+  // move events that came into reach into the ring
+  while(!overflow.empty() && overflow.begin()->first - now < slots)
+    {
+      if(overflow.begin()->first == time)
+        due.push_back(overflow.begin()->second);
+      else
+        {
+          ring[overflow.begin()->first % slots].push_back(overflow.begin()->second);
+          count++;
+        }
+      overflow.erase(overflow.begin());
+    }
+}
+
+void detail::event_wheel::entries(std::vector<std::pair<uint64_t, base*> > &result) const
+{
+  for(unsigned int c = 0; c < slots; c++)
+    for(auto p : ring[(now + c) % slots])
+      result.push_back(std::make_pair(now + c, p));
+  for(auto &e : overflow)
+    result.push_back(e);
+}
@@ -0,0 +1,71 @@
+/******************************************************************************
+ * Copyright (c) 2015-2016, Nils Christopher Brause
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *****************************************************************************/
+
+
+#ifndef WHEEL_HPP
+#define WHEEL_HPP
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include <base.hpp>
+
+namespace hdl
+{
+  namespace detail
+  {
+    // Calendar queue of part wake-up times. Events in the near future
+    // live in a ring of buckets indexed by time modulo the ring size,
+    // events further away in an ordered overflow map.
+    class event_wheel
+    {
+    private:
+      static const unsigned int slots = 256;
+      std::vector<std::vector<base*> > ring;
+      std::multimap<uint64_t, base*> overflow;
+      uint64_t now = 0;
+      std::size_t count = 0;
+
+    public:
+      event_wheel();
+
+      void schedule(uint64_t time, base *p);
+      bool empty() const;
+
+      // earliest pending wake-up time
+      uint64_t next() const;
+
+      // remove all parts due at time and advance the wheel
+      void pop(uint64_t time, std::vector<base*> &due);
+
+      // all pending wake-ups
+      void entries(std::vector<std::pair<uint64_t, base*> > &result) const;
+    };
+  }
+}
+
+#endif
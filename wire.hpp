@@ -28,6 +28,7 @@
 #ifndef WIRE_HPP
 #define WIRE_HPP
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <map>
@@ -35,8 +36,13 @@
 #include <mutex>
 #include <limits>
 #include <set>
+#include <type_traits>
+#include <vector>
 
 #include <base.hpp>
+#include <context.hpp>
+#include <graph.hpp>
+#include <snapshot.hpp>
 
 namespace hdl
 {
@@ -45,6 +51,21 @@ namespace hdl
 
   namespace detail
   {
+    // logic level of a value for edge detection
+    template <typename T>
+    typename std::enable_if<std::is_convertible<T, bool>::value, bool>::type
+    high(const T &t)
+    {
+      return static_cast<bool>(t);
+    }
+
+    template <typename T>
+    typename std::enable_if<!std::is_convertible<T, bool>::value, bool>::type
+    high(const T &t)
+    {
+      return !(t == T());
+    }
+
 #ifdef MULTIASSIGN
     // Resolve multiple assignments to a wire.
     // Has to be reimplemented by types with high-Z support.
@@ -61,6 +82,13 @@ namespace hdl
         }
       return candidates.begin()->second;
     }
+
+    // Whether resolve() returns the value of a single driver unchanged.
+    template <typename T>
+    bool resolves_to_itself(const T &, const detail::base *)
+    {
+      return true;
+    }
 #endif
   }
 
@@ -71,57 +99,93 @@ namespace hdl
     class wire_int : public detail::base
     {
     private:
-      T state;
-      T prev_state;
+      // the values live in the store of the context
+      detail::value_store<T> &store;
+      unsigned int slot;
 #ifdef MULTIASSIGN
-      std::map<base*, T> drivers;
-#else
-      T next_state;
-      bool been_set;
-#ifdef DEBUG
+      // Parts that declare the wire as output get a fixed driver slot
+      // in the store when the context is frozen. Everyone else (e.g.
+      // the initial value) ends up in others.
+      unsigned int first_driver = 0;
+      unsigned int ndrivers = 0;
+      std::unique_ptr<std::map<base*, T> > others;
+#elif defined(DEBUG)
       std::set<base*> drivers;
 #endif
-#endif
-      bool first;
-      std::map<base*, bool> seen_event;
-      std::mutex mutex;
+      // After alias() the wire that owns the value, the id of this wire
+      // is stale once the optimizer has renumbered the context.
+      wire_int *root = nullptr;
+      std::unique_ptr<std::vector<wire_int*> > aliases;
 
       virtual void update(uint64_t)
       {
 #ifdef MULTIASSIGN
-        if(drivers.size() > 0)
+        if(ndrivers == 1 && !others
+           && resolves_to_itself(store.driver_value[first_driver], this))
+          {
+            // The only driver is the one that has set the wire. The
+            // slot starts out with the initial state, so there is
+            // nothing to resolve.
+            store.prev_state[slot] = store.state[slot];
+            store.state[slot] = store.driver_value[first_driver];
+            if(get() != get_prev())
+              store.changed_at[slot] = store.delta;
+          }
+        else
           {
-            prev_state = state;
-            state = resolve(drivers, this);
-            for(auto &c : seen_event)
-              c.second = false;
+            std::map<base*, T> drivers;
+            get_drivers(drivers);
+            if(drivers.size() > 0)
+              {
+                store.prev_state[slot] = store.state[slot];
+                store.state[slot] = resolve(drivers, this);
+                if(get() != get_prev())
+                  store.changed_at[slot] = store.delta;
+              }
           }
 #else
-        if(been_set)
+        if(store.been_set.test(slot))
           {
-            prev_state = state;
-            state = next_state;
-            for(auto &c : seen_event)
-              c.second = false;
-            been_set = false;
+            store.prev_state[slot] = store.state[slot];
+            store.state[slot] = store.next_state[slot];
+            if(get() != get_prev())
+              store.changed_at[slot] = store.delta;
+            store.been_set.reset(slot);
           }
 #endif
-        set_changed(false);
+        store.changed.reset(id);
       }
 
       template <typename U>
       void set(const U &u)
       {
+        if(root)
+          {
+            root->set(u);
+            return;
+          }
         T t;
         t = u;
 #ifdef MULTIASSIGN
-        {
-          std::lock_guard<std::mutex> lock(mutex);
-          drivers[get_cur_part()] = t;
-        }
-        if(!changed())
-          if(t != state)
-            set_changed(true);
+        base *d = get_cur_part();
+        unsigned int n = first_driver;
+        while(n < first_driver + ndrivers && store.driver_part[n] != d)
+          n++;
+        if(n < first_driver + ndrivers)
+          {
+            store.driver_value[n] = t;
+            store.driver_set[n] = true;
+          }
+        else
+          {
+            std::lock_guard<std::mutex> lock(store.lock(slot));
+            if(!others)
+              others.reset(new std::map<base*, T>());
+            (*others)[d] = t;
+          }
+        if(!store.changed.test(id))
+          if(t != get())
+            store.changed.set(id);
           /*
           if(resolve(drivers, this) != state)
             been_changed = true;
@@ -129,7 +193,7 @@ namespace hdl
 #else
 #ifdef DEBUG
         {
-          std::lock_guard<std::mutex> lock(mutex);
+          std::lock_guard<std::mutex> lock(store.lock(slot));
           drivers.insert(get_cur_part());
         }
         if(drivers.size() > 1)
@@ -139,25 +203,196 @@ namespace hdl
               std::cout << "  " << (!d ? "NULL" : d->getname()) << std::endl;
           }
 #endif
-        next_state = t;
-        been_set = true;
-        if(!changed())
-          if(next_state != state)
-            set_changed(true);
+        store.next_state[slot] = t;
+        store.been_set.set(slot);
+        if(!store.changed.test(id))
+          if(t != get())
+            store.changed.set(id);
 #endif
       }
       
-      T get()
+#ifdef MULTIASSIGN
+      // all drivers that have set the wire so far
+      void get_drivers(std::map<base*, T> &drivers) const
+      {
+        if(others)
+          drivers = *others;
+        for(unsigned int n = first_driver; n < first_driver + ndrivers; n++)
+          if(store.driver_set[n])
+            drivers[store.driver_part[n]] = store.driver_value[n];
+      }
+
+      void set_drivers(const std::map<base*, T> &drivers)
+      {
+        others.reset();
+        for(unsigned int n = first_driver; n < first_driver + ndrivers; n++)
+          store.driver_set[n] = false;
+        for(auto &d : drivers)
+          {
+            unsigned int n = first_driver;
+            while(n < first_driver + ndrivers && store.driver_part[n] != d.first)
+              n++;
+            if(n < first_driver + ndrivers)
+              {
+                store.driver_value[n] = d.second;
+                store.driver_set[n] = true;
+              }
+            else
+              {
+                if(!others)
+                  others.reset(new std::map<base*, T>());
+                (*others)[d.first] = d.second;
+              }
+          }
+      }
+
+      virtual void freeze(const detail::graph &g)
+      {
+        std::map<base*, T> drivers;
+        get_drivers(drivers);
+        ndrivers = g.writers.last(id) - g.writers.first(id);
+        first_driver = store.add_drivers(ndrivers, get());
+        for(unsigned int n = 0; n < ndrivers; n++)
+          store.driver_part[first_driver + n] = g.parts[g.writers.first(id)[n]];
+        set_drivers(drivers);
+      }
+
+      // keep the drivers in others until freeze() assigns new slots
+      virtual void thaw()
       {
-        return state;
+        std::map<base*, T> drivers;
+        get_drivers(drivers);
+        first_driver = 0;
+        ndrivers = 0;
+        set_drivers(drivers);
+      }
+#endif
+
+      T get() const
+      {
+        return store.state[slot];
+      }
+
+      T get_prev() const
+      {
+        return store.prev_state[slot];
+      }
+
+      virtual bool rose()
+      {
+        return !detail::high(get_prev()) && detail::high(get());
       }
 
-      bool event()
+      virtual bool fell()
       {
-        std::lock_guard<std::mutex> lock(mutex);
-        bool seen = seen_event[get_cur_part()];
-        seen_event[get_cur_part()] = true;
-        return (prev_state != state) && !seen;
+        return detail::high(get_prev()) && !detail::high(get());
+      }
+
+      // changed in the current delta cycle
+      bool event() const
+      {
+        return store.changed_at[slot] == store.delta;
+      }
+
+      virtual bool value_changed() const
+      {
+        return event();
+      }
+
+      virtual bool differs() const
+      {
+        return get() != get_prev();
+      }
+
+      virtual unsigned int value_slot() const
+      {
+        return slot;
+      }
+
+      virtual bool resolved() const
+      {
+#ifdef MULTIASSIGN
+        return ndrivers != 1 || others;
+#else
+        return false;
+#endif
+      }
+
+      virtual bool alias(base *target)
+      {
+        wire_int *t = dynamic_cast<wire_int*>(target);
+        if(!t)
+          return false;
+        if(!t->aliases)
+          t->aliases.reset(new std::vector<wire_int*>());
+        if(aliases)
+          for(wire_int *a : *aliases)
+            {
+              a->slot = t->slot;
+              a->root = t;
+              t->aliases->push_back(a);
+            }
+        aliases.reset();
+        slot = t->slot;
+        root = t;
+        t->aliases->push_back(this);
+        return true;
+      }
+
+      virtual void hold()
+      {
+#ifdef MULTIASSIGN
+        std::map<base*, T> drivers;
+        drivers[NULL] = get();
+        set_drivers(drivers);
+#endif
+      }
+
+      virtual void save(detail::archive &a)
+      {
+        a.write(get());
+        a.write(get_prev());
+#ifdef MULTIASSIGN
+        std::map<base*, T> drivers;
+        get_drivers(drivers);
+        a.write(drivers.size());
+        for(auto &d : drivers)
+          {
+            a.write_part(d.first);
+            a.write(d.second);
+          }
+#else
+        a.write(T(store.next_state[slot]));
+        a.write(store.been_set.test(slot));
+#endif
+        a.write(store.changed_at[slot]);
+      }
+
+      virtual void load(detail::archive &a)
+      {
+        T t;
+        a.read(t);
+        store.state[slot] = t;
+        a.read(t);
+        store.prev_state[slot] = t;
+#ifdef MULTIASSIGN
+        std::size_t n;
+        std::map<base*, T> drivers;
+        a.read(n);
+        for(std::size_t c = 0; c < n; c++)
+          {
+            base *d = a.read_part();
+            a.read(drivers[d]);
+          }
+        set_drivers(drivers);
+#else
+        bool b;
+        a.read(t);
+        store.next_state[slot] = t;
+        a.read(b);
+        store.been_set.assign(slot, b);
+#endif
+        a.read(store.changed_at[slot]);
       }
 
       std::string print()
@@ -167,15 +402,22 @@ namespace hdl
         return ss.str();
       }
       
+    public:
       wire_int()
-        : state(T()), prev_state(T()),
-#ifndef MULTIASSIGN
-          been_set(false),
-#endif
-          first(true)
+        : store(context::current().store<T>()), slot(store.add())
       {
       }
-      
+
+      ~wire_int()
+      {
+        if(root)
+          root->aliases->erase(std::remove(root->aliases->begin(), root->aliases->end(), this),
+                               root->aliases->end());
+        if(aliases)
+          for(wire_int *a : *aliases)
+            a->root = nullptr;
+      }
+
       friend class wire<T>;
     };
 
@@ -183,18 +425,21 @@ namespace hdl
 
   public:
     wire()
-      : w(new wire_int())
+      : w(std::make_shared<wire_int>())
     {
-      detail::wires.push_back(w);
+      context::current().add_wire(w);
     }
 
     wire(T initial)
-      : w(new wire_int())
+      : w(std::make_shared<wire_int>())
     {
+      context::current().add_wire(w);
       w->set(initial);
-      detail::wires.push_back(w);
     }
 
+    // Whether the value changed in the current delta cycle, like
+    // 'event in VHDL. A part woken up later in the same time step (e.g.
+    // by a reset released through gates) does not see the event.
     bool event() const
     {
       return w->event();